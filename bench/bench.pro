@@ -0,0 +1,9 @@
+# Synthetic input generator and benchmarks, built separately from the
+# application: qmake bench/bench.pro && make
+
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    benchmark \
+    fuzz \
+    gencatalogue
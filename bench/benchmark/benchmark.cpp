@@ -0,0 +1,244 @@
+#include "benchmark.h"
+#include "ui_mainwindow.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+
+#include "cataloguegenerator.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/resource.h>
+#endif
+
+Benchmark::Benchmark(int rows, quint32 seed) :
+    rows(rows),
+    seed(seed)
+{
+}
+
+Benchmark::~Benchmark()
+{
+    delete window;
+}
+
+/* Writes a generated series list to the settings directory, so that it is
+ * loaded when the window is created, and runs the suites. The settings turn
+ * off the connection to epguides opened at startup. */
+bool Benchmark::run()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QDir().mkpath(dir);
+    QFile settings(dir + "/" SETTINGS_FILENAME);
+    if (!settings.open(QIODevice::WriteOnly | QIODevice::Text)
+            || (settings.write(SETTINGS_PRECONNECT " false\n") < 0)) {
+        QTextStream(stderr) << "Could not write " << settings.fileName() << "\n";
+        return false;
+    }
+    settings.close();
+
+    QFile file(dir + "/" SERIESLIST_FILENAME);
+    CatalogueGenerator generator(seed);
+    if (!file.open(QIODevice::WriteOnly) || (file.write(generator.seriesList(rows)) < 0)) {
+        QTextStream(stderr) << "Could not write " << file.fileName() << "\n";
+        return false;
+    }
+    file.close();
+
+    // Startup: parsing the series list and filling the list widget
+    QElapsedTimer timer;
+    timer.start();
+    window = new MainWindow();
+    report("load", QString(), elapsedMs(timer), window->seriesList.count());
+
+    benchParseThreads();
+    benchSearch();
+    benchYearQuery();
+    benchEpisodeParse();
+    benchEpisodeListOpen();
+    return true;
+}
+
+/* Parses the series list with 1, 2, 4 and so on threads, up to the number of
+ * cores, to show how parsing scales. */
+void Benchmark::benchParseThreads()
+{
+    QByteArray data = CatalogueGenerator(seed).seriesList(rows);
+
+    QList<int> threadCounts;
+    int cores = qMax(1, QThread::idealThreadCount());
+    for (int threads=1; threads < cores; threads *= 2) {
+        threadCounts.append(threads);
+    }
+    threadCounts.append(cores);
+
+    int parseThreads = window->parseThreads;
+    foreach (int threads, threadCounts) {
+        window->seriesList.clear();
+        window->seriesNumberMap.clear();
+        window->parseThreads = threads;
+
+        QElapsedTimer timer;
+        timer.start();
+        window->parseSeriesList(data);
+        report("parse-threads", QString::number(threads), elapsedMs(timer),
+               window->seriesList.count());
+    }
+    window->parseThreads = parseThreads;
+}
+
+/* Searches as typed in the search bar, including filling the list widget. */
+void Benchmark::benchSearch()
+{
+    // Common and rare words, no match, and searches with filters. None of
+    // these may match a single series, which would open its episode list.
+    static const char* queries[] = {"", "the", "pokemon", "zzzz", "star year:2015..2020",
+                                    "status:ended"};
+    static const int queryCount = sizeof(queries) / sizeof(queries[0]);
+
+    for (int i=0; i < queryCount; i++) {
+        QString query = queries[i];
+        window->ui->lineEdit->setText(query);
+        QElapsedTimer timer;
+        timer.start();
+        window->on_getButton_clicked();
+        report("search", query, elapsedMs(timer), window->seriesListGUI.count());
+    }
+}
+
+/* Times the query part of searches with a year range, as done by
+ * on_getButton_clicked() before the list widget is filled: a binary search of
+ * the year index, intersected with the text and status search. The time is
+ * the average of a number of repeats, as it should be well under a
+ * millisecond. */
+void Benchmark::benchYearQuery()
+{
+    static const char* queries[] = {"year:2015..2020", "star year:2015..2020",
+                                    "year:1999 status:ended"};
+    static const int queryCount = sizeof(queries) / sizeof(queries[0]);
+    const int repeats = 100;
+
+    window->ui->spinBox_yearFrom->setValue(0);
+    window->ui->spinBox_yearTo->setValue(0);
+    window->ui->comboBox_status->setCurrentIndex(0);
+
+    for (int i=0; i < queryCount; i++) {
+        QString text = queries[i];
+        QList<SeriesPtr> rows;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int r=0; r < repeats; r++) {
+            rows.clear();
+            SeriesQuery query = window->parseSeriesQuery(text);
+            SeriesRange range = window->seriesInYearRange(query.yearFrom, query.yearTo);
+            for (SeriesRange::first_type it = range.first; it != range.second; ++it) {
+                if (window->matchesQuery(*it, query)) {
+                    rows.append(*it);
+                }
+            }
+            std::sort(rows.begin(), rows.end(),
+                      [](const SeriesPtr &a, const SeriesPtr &b) {
+                return a->index < b->index;
+            });
+        }
+        report("year-query", text, elapsedMs(timer) / repeats, rows.count());
+    }
+}
+
+/* Parses rows episode lines of each schema, without the GUI, for the
+ * throughput of the schema-specialised parsers. */
+void Benchmark::benchEpisodeParse()
+{
+    for (int maze=1; maze >= 0; maze--) {
+        SeriesPtr series = seriesWithFormat(maze);
+        if (!series) { continue; }
+
+        CatalogueGenerator generator(seed);
+        QStringList lines = QString::fromUtf8(generator.episodeList(
+                maze ? CatalogueGenerator::MazeFormat : CatalogueGenerator::RageFormat,
+                rows)).split('\n');
+
+        int parsed = 0;
+        QElapsedTimer timer;
+        timer.start();
+        EpisodeListParser parser(series);
+        foreach (QString line, lines) {
+            if (parser.parseLine(line)) {
+                parsed++;
+            }
+        }
+        report("episode-parse", maze ? "maze" : "rage", elapsedMs(timer), parsed);
+    }
+}
+
+/* Opens an episode list of rows episodes from its cache file, in both formats.
+ * The in-memory cache is cleared first so that the file is parsed. */
+void Benchmark::benchEpisodeListOpen()
+{
+    for (int maze=1; maze >= 0; maze--) {
+        SeriesPtr series = seriesWithFormat(maze);
+        if (!series) { continue; }
+
+        CatalogueGenerator generator(seed);
+        QFile file(window->getSettingsDir(window->getSeriesCacheFilename(series)));
+        if (!file.open(QIODevice::WriteOnly)) { continue; }
+        file.write(generator.episodeList(maze ? CatalogueGenerator::MazeFormat
+                                              : CatalogueGenerator::RageFormat, rows));
+        file.close();
+
+        window->epListCache.clear();
+        QElapsedTimer timer;
+        timer.start();
+        window->loadEpList(series);
+        report("eplist-open", maze ? "maze" : "rage", elapsedMs(timer),
+               window->epList.count());
+    }
+}
+
+/* Returns a series whose episode list is in the maze format, or in the rage
+ * format, which is only used for series without a maze number. */
+SeriesPtr Benchmark::seriesWithFormat(bool maze)
+{
+    foreach (SeriesPtr s, window->seriesList) {
+        if (maze ? !s->mazeNo.isEmpty() : (s->mazeNo.isEmpty() && !s->rageNo.isEmpty())) {
+            return s;
+        }
+    }
+    return SeriesPtr();
+}
+
+double Benchmark::elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+void Benchmark::report(QString suite, QString param, double ms, int results)
+{
+    QJsonObject result;
+    result.insert("suite", suite);
+    result.insert("param", param);
+    result.insert("rows", rows);
+    result.insert("ms", ms);
+    result.insert("results", results);
+    result.insert("peakRssKb", double(peakRssKb()));
+
+    QTextStream out(stdout);
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n";
+    out.flush();
+}
+
+/* Returns the peak resident memory of the process in KB, or -1 if unknown. */
+qint64 Benchmark::peakRssKb()
+{
+#ifdef Q_OS_LINUX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return -1;
+}
@@ -0,0 +1,40 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include "mainwindow.h"
+
+
+/* Runs the benchmark suites for one input size on a MainWindow started from a
+ * generated series list. Each measurement is written to standard output as a
+ * JSON object on one line, with the peak memory of the process so far. */
+class Benchmark
+{
+public:
+    Benchmark(int rows, quint32 seed);
+    ~Benchmark();
+
+    bool run();
+
+private:
+    int rows;
+    quint32 seed;
+    MainWindow *window = 0;
+
+    void benchParseThreads();
+    void benchSearch();
+    void benchYearQuery();
+    void benchEpisodeParse();
+    void benchEpisodeListOpen();
+    SeriesPtr seriesWithFormat(bool maze);
+
+    void report(QString suite, QString param, double ms, int results);
+    static double elapsedMs(const QElapsedTimer &timer);
+    static qint64 peakRssKb();
+};
+
+
+#endif // BENCHMARK_H
@@ -0,0 +1,19 @@
+# Measures the time and peak memory of loading, searching and opening episode
+# lists on synthetic input of increasing size. Runs on Linux.
+
+CONFIG += qt console
+CONFIG -= app_bundle
+QT     += core gui widgets network concurrent
+
+TARGET = benchmark
+TEMPLATE = app
+
+include(../../src/seriesapp.pri)
+include(../common/common.pri)
+
+HEADERS += \
+    benchmark.h
+
+SOURCES += \
+    benchmark.cpp \
+    main.cpp
@@ -0,0 +1,54 @@
+#include <QApplication>
+#include <QProcess>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "benchmark.h"
+
+/* Usage: benchmark [--rows 10000,100000,1000000] [--seed n]
+ * Runs the benchmark for each number of rows in a separate process, so that
+ * the peak memory is measured per size, and writes one JSON object per
+ * measurement per line to standard output. */
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for (int i=0; i < argc; i++) {
+        args.append(QString::fromLocal8Bit(argv[i]));
+    }
+    QString rowsArg = args.contains("--rows") ? args.value(args.indexOf("--rows") + 1)
+                                              : "10000,100000,1000000";
+    QString seed = args.contains("--seed") ? args.value(args.indexOf("--seed") + 1) : "1";
+
+    if (args.contains("--child")) {
+        // Keep settings, caches and the local socket apart from a real
+        // instance and from the other runs
+        QTemporaryDir home;
+        qputenv("HOME", home.path().toLocal8Bit());
+        qputenv("XDG_CONFIG_HOME", (home.path() + "/.config").toLocal8Bit());
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+
+        QApplication a(argc, argv);
+        a.setApplicationName("seriesapp");
+        Benchmark benchmark(rowsArg.toInt(), seed.toUInt());
+        return benchmark.run() ? 0 : 1;
+    }
+
+    QCoreApplication a(argc, argv);
+    int failed = 0;
+    foreach (QString rows, rowsArg.split(',')) {
+        if (rows.isEmpty()) { continue; }
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(a.applicationFilePath(), QStringList()
+                    << "--child" << "--rows" << rows << "--seed" << seed);
+        child.waitForFinished(-1);
+        if ((child.exitStatus() != QProcess::NormalExit) || (child.exitCode() != 0)) {
+            QTextStream(stderr) << "Benchmark of " << rows << " rows failed\n";
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+#include "cataloguegenerator.h"
+
+#include <QDate>
+#include <QLocale>
+#include <QStringList>
+#include <QVector>
+
+#include <utility>
+
+CatalogueGenerator::CatalogueGenerator(quint32 seed)
+{
+    // Xorshift state must not be zero
+    state = seed ? seed : 1;
+}
+
+/* Returns an allshows.txt style series list with the specified number of
+ * series rows, after the header line. */
+QByteArray CatalogueGenerator::seriesList(int rows)
+{
+    static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    static const char* networks[] = {"HBO", "BBC One", "Netflix", "AMC", "FOX",
+                                     "NHK", "ZDF", "Showtime", "Hulu", "ABC"};
+    static const char* countries[] = {"US", "UK", "JP", "DE", "CA", "AU"};
+
+    QByteArray data;
+    data.reserve(rows * 80);
+    data += "title,directory,tvrage,TVmaze,start date,end date,number of episodes,"
+            "run time,network,country\n";
+
+    QVector< std::pair<int, int> > ids; // Maze and rage numbers, 0 if none
+    ids.reserve(rows);
+
+    for (int i=0; i < rows; i++) {
+        QString name = title(1, 4);
+        if (chance(3)) {
+            name += ", The";    // Quoted comma
+        }
+
+        QString directory;
+        foreach (QChar c, name) {
+            if (c.isLetterOrNumber() && (c.unicode() < 128)) {
+                directory += c;
+            }
+        }
+
+        // Some series are listed again with the same numbers; the first wins
+        std::pair<int, int> id;
+        if (!ids.isEmpty() && chance(2)) {
+            id = ids.at(range(0, ids.count() - 1));
+        } else {
+            int kind = range(0, 99);
+            id.first = (kind < 85) ? i + 1 : 0;             // Maze
+            id.second = (kind >= 25) ? 100000 + i : 0;      // Rage
+        }
+        ids.append(id);
+
+        int startYear = range(1950, 2025);
+        QString start = QString("%1 %2").arg(months[range(0, 11)]).arg(startYear);
+        QString end;
+        if (chance(50)) {
+            end = QString("%1 %2").arg(months[range(0, 11)])
+                    .arg(qMin(2025, startYear + range(0, 12)));
+        }
+
+        QString line = "\"" + name + "\"," + directory + ","
+                + (id.second ? QString::number(id.second) : QString()) + ","
+                + (id.first ? QString::number(id.first) : QString()) + ","
+                + start + "," + end + ","
+                + QString("%1 eps,%2 min,").arg(range(1, 500)).arg(range(2, 12) * 5)
+                + networks[range(0, 9)] + "," + countries[range(0, 5)] + "\n";
+        data += line.toUtf8();
+    }
+
+    return data;
+}
+
+/* Returns an episode list CSV in the specified format with the specified
+ * number of episode rows, after the header line. */
+QByteArray CatalogueGenerator::episodeList(EpisodeFormat format, int rows)
+{
+    static const QLocale locale(QLocale::English, QLocale::UnitedStates);
+
+    QByteArray data;
+    data.reserve(rows * 80);
+    if (format == MazeFormat) {
+        data += "number,season,episode,airdate,title,tvmaze link\n";
+    } else {
+        data += "number,season,episode,production code,airdate,title,special?,tvrage\n";
+    }
+
+    QDate date(1990, 1, 1);
+    int number = 0;
+    int season = 1;
+    int episode = 0;
+    int seasonLength = range(8, 24);
+    int specials = 0;
+
+    for (int i=0; i < rows; i++) {
+        bool special = chance(3);
+        QString name = title(1, 5);
+        if (chance(3)) {
+            name += ", Part " + QString::number(range(1, 3)); // Quoted comma
+        }
+
+        QString numberCol;
+        int episodeNo;
+        if (special) {
+            specials++;
+            numberCol = "S";
+            episodeNo = specials;
+        } else {
+            if (episode == seasonLength) {
+                season++;
+                episode = 0;
+                seasonLength = range(8, 24);
+                date = date.addDays(180);
+            }
+            number++;
+            episode++;
+            numberCol = QString::number(number);
+            episodeNo = episode;
+        }
+
+        // Keep dates in the range that two digit years can express
+        date = date.addDays(7);
+        if (date.year() > 2025) {
+            date = QDate(1990, 1, 1);
+        }
+
+        QString line;
+        if (format == MazeFormat) {
+            line = QString("%1,%2,%3,%4,\"%5\",\"https://www.tvmaze.com/episodes/%6/episode\"\n")
+                    .arg(numberCol).arg(season).arg(episodeNo)
+                    .arg(locale.toString(date, "dd MMM yy"))
+                    .arg(name).arg(i + 1);
+        } else {
+            line = QString("%1,%2,%3,\"%4\",%5,\"%6\",%7\n")
+                    .arg(numberCol).arg(season).arg(episodeNo)
+                    .arg(season * 100 + episodeNo)
+                    .arg(locale.toString(date, "d/MMM/yy"))
+                    .arg(name).arg(special ? "y" : "n");
+        }
+        data += line.toUtf8();
+    }
+
+    return data;
+}
+
+/* Returns a title of random words, some with accented letters or characters
+ * that epguides escapes as HTML. */
+QString CatalogueGenerator::title(int minWords, int maxWords)
+{
+    static const char* words[] = {
+        "The", "Star", "Night", "City", "Doctor", "Law", "Order", "Dark",
+        "House", "Lost", "Game", "Crown", "Breaking", "Bad", "Office", "Agents",
+        "Shield", "Wire", "Friends", "Family", "Murder", "Mystery", "Island",
+        "Blue", "Red", "Black", "Mirror", "Station", "Hospital", "Chronicles",
+        "Legend", "Empire", "Kingdom", "Secret", "Life", "Time", "Travel",
+        "Detective", "Space", "Ocean", "Mountain", "Border", "Street", "Club",
+        "Show", "Tonight", "Morning", "Story", "Heroes", "Wild", "Young",
+        "Old", "Little", "Big", "Sister", "Brother", "Father", "Mother", "Home"
+    };
+    static const int wordCount = sizeof(words) / sizeof(words[0]);
+    static const char* special[] = {
+        "Pok\xc3\xa9mon", "Caf\xc3\xa9", "Se\xc3\xb1or", "M\xc3\xbcnchen",
+        "Marvel&#39;s", "S.H.I.E.L.D.", "&amp;", "Love &amp; War", "Mr. Robot"
+    };
+    static const int specialCount = sizeof(special) / sizeof(special[0]);
+
+    QStringList parts;
+    int count = range(minWords, maxWords);
+    for (int i=0; i < count; i++) {
+        if (chance(5)) {
+            parts.append(QString::fromUtf8(special[range(0, specialCount - 1)]));
+        } else {
+            parts.append(words[range(0, wordCount - 1)]);
+        }
+    }
+    return parts.join(" ");
+}
+
+quint32 CatalogueGenerator::next()
+{
+    // Xorshift32, so that output does not depend on the Qt version
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/* Returns a number from min to max, inclusive. */
+int CatalogueGenerator::range(int min, int max)
+{
+    return min + int(next() % quint32(max - min + 1));
+}
+
+bool CatalogueGenerator::chance(int percent)
+{
+    return range(0, 99) < percent;
+}
@@ -0,0 +1,38 @@
+#ifndef CATALOGUEGENERATOR_H
+#define CATALOGUEGENERATOR_H
+
+
+#include <QByteArray>
+#include <QString>
+
+
+/* Generates synthetic input in the formats downloaded from epguides: the
+ * series list (allshows.txt) and maze and rage episode list CSVs. The data
+ * mimics the awkward parts of the real lists: HTML escape sequences and
+ * accented letters in names, quoted commas, duplicate series ids, series with
+ * only a maze or rage number and specials. The same seed gives the same
+ * output. */
+class CatalogueGenerator
+{
+public:
+    enum EpisodeFormat
+    {
+        MazeFormat,
+        RageFormat
+    };
+
+    explicit CatalogueGenerator(quint32 seed = 1);
+
+    QByteArray seriesList(int rows);
+    QByteArray episodeList(EpisodeFormat format, int rows);
+
+private:
+    quint32 state;
+    quint32 next();
+    int range(int min, int max);
+    bool chance(int percent);
+    QString title(int minWords, int maxWords);
+};
+
+
+#endif // CATALOGUEGENERATOR_H
@@ -0,0 +1,9 @@
+# Synthetic input shared by the benchmark, fuzzer and generator tool
+
+INCLUDEPATH += $$PWD
+
+HEADERS += \
+    $$PWD/cataloguegenerator.h
+
+SOURCES += \
+    $$PWD/cataloguegenerator.cpp
@@ -0,0 +1,29 @@
+# Feeds mutated episode list lines to the maze and rage episode parsers under
+# the address and undefined behaviour sanitizers. By default, a randomized
+# driver mutates generated lines; with clang, qmake CONFIG+=libfuzzer builds a
+# libFuzzer target instead.
+
+CONFIG += qt console
+CONFIG -= app_bundle
+QT     += core gui
+
+TARGET = fuzz_episode
+TEMPLATE = app
+
+# Only the parsers in episodeparser.h are used
+INCLUDEPATH += ../../src
+
+include(../common/common.pri)
+
+SOURCES += \
+    fuzz_episode.cpp
+
+QMAKE_CXXFLAGS += -g -fno-omit-frame-pointer -fsanitize=address,undefined \
+    -fno-sanitize-recover=undefined
+QMAKE_LFLAGS += -fsanitize=address,undefined
+
+libfuzzer {
+    DEFINES += SERIESAPP_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer
+    QMAKE_LFLAGS += -fsanitize=fuzzer
+}
@@ -0,0 +1,115 @@
+#include <QGuiApplication>
+#include <QTextStream>
+
+#include <random>
+
+#include "cataloguegenerator.h"
+#include "episodeparser.h"
+
+static SeriesPtr mazeSeries;
+static SeriesPtr rageSeries;
+
+static void setUp(int &argc, char **argv)
+{
+    // Names with HTML escape sequences are decoded with QTextDocument, which
+    // needs a GUI application
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    static QGuiApplication app(argc, argv);
+
+    mazeSeries = SeriesPtr(new Series(
+            "\"Dexter\",Dexter,8213,161,Oct 2006,Sep 2013,96 eps,60 min,Showtime,US"));
+    rageSeries = SeriesPtr(new Series(
+            "\"Cheers\",Cheers,3205,,Sep 1982,May 1993,275 eps,30 min,NBC,US"));
+}
+
+/* Parses the input as a single line with both schemas and as a series list
+ * line, and line by line as an episode list, which may switch schemas on a
+ * header line. */
+static void parseInput(const QByteArray &data)
+{
+    QString text = QString::fromUtf8(data);
+
+    parseEpisode<EpisodeSchemaMaze>(text, mazeSeries);
+    parseEpisode<EpisodeSchemaRage>(text, rageSeries);
+    Series series(text);
+
+    EpisodeListParser parser(mazeSeries);
+    foreach (QString line, text.split('\n')) {
+        parser.parseLine(line);
+    }
+}
+
+#ifdef SERIESAPP_LIBFUZZER
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    setUp(*argc, *argv);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    parseInput(QByteArray(reinterpret_cast<const char*>(data), int(size)));
+    return 0;
+}
+
+#else
+
+static void mutate(QByteArray &input, std::mt19937 &rng)
+{
+    static const char tokens[] = ",\"&;<>S0123456789/\n\r\t \xc3\xa9\xff";
+    char token = tokens[rng() % (sizeof(tokens) - 1)];
+    int pos = input.isEmpty() ? 0 : int(rng() % quint32(input.size()));
+
+    switch (rng() % 5) {
+    case 0:
+        if (!input.isEmpty()) { input[pos] = char(rng()); }
+        break;
+    case 1:
+        input.insert(pos, token);
+        break;
+    case 2:
+        input.remove(pos, int(rng() % 8));
+        break;
+    case 3:
+        input.truncate(pos);
+        break;
+    default:
+        input.insert(pos, input.mid(pos, int(rng() % 16)));
+        break;
+    }
+}
+
+/* Usage: fuzz_episode [iterations] [seed]
+ * Mutates lines of generated episode lists and edge cases at random. */
+int main(int argc, char *argv[])
+{
+    setUp(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    int iterations = args.value(1, "100000").toInt();
+    quint32 seed = args.value(2, "1").toUInt();
+
+    CatalogueGenerator generator(seed);
+    QList<QByteArray> corpus;
+    corpus += generator.episodeList(CatalogueGenerator::MazeFormat, 200).split('\n');
+    corpus += generator.episodeList(CatalogueGenerator::RageFormat, 200).split('\n');
+    corpus << "" << "S" << "1" << "," << "\"" << "1,1,1,,\"" << "S,,,,,,,,"
+           << "1,1,1,99 Xyz 99,\"&amp;<b>\",\"\"" << "number,season,episode,tvrage";
+
+    std::mt19937 rng(seed);
+    for (int i=0; i < iterations; i++) {
+        QByteArray input = corpus.at(int(rng() % quint32(corpus.count())));
+        int mutations = 1 + int(rng() % 8);
+        for (int m=0; m < mutations; m++) {
+            mutate(input, rng);
+        }
+        parseInput(input);
+    }
+
+    QTextStream(stdout) << "Parsed " << iterations << " mutated inputs\n";
+    return 0;
+}
+
+#endif
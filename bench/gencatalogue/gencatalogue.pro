@@ -0,0 +1,13 @@
+# Writes a synthetic series list or episode list CSV to standard output
+
+CONFIG += qt console
+CONFIG -= app_bundle
+QT     = core
+
+TARGET = gencatalogue
+TEMPLATE = app
+
+include(../common/common.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,42 @@
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include "cataloguegenerator.h"
+
+/* Usage: gencatalogue series|maze|rage <rows> [seed]
+ * Writes the generated list to standard output, e.g.
+ *   gencatalogue series 1000000 > ~/.config/seriesapp/seriesList.txt */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+    QTextStream err(stderr);
+
+    QString kind = args.value(1);
+    bool ok = false;
+    int rows = args.value(2).toInt(&ok);
+    quint32 seed = args.value(3, "1").toUInt();
+    if (!ok || (rows < 0) || !(QStringList() << "series" << "maze" << "rage").contains(kind)) {
+        err << "Usage: gencatalogue series|maze|rage <rows> [seed]\n";
+        return 1;
+    }
+
+    CatalogueGenerator generator(seed);
+    QByteArray data;
+    if (kind == "series") {
+        data = generator.seriesList(rows);
+    } else if (kind == "maze") {
+        data = generator.episodeList(CatalogueGenerator::MazeFormat, rows);
+    } else {
+        data = generator.episodeList(CatalogueGenerator::RageFormat, rows);
+    }
+
+    QFile out;
+    if (!out.open(stdout, QIODevice::WriteOnly) || (out.write(data) != data.size())) {
+        err << "Could not write output\n";
+        return 1;
+    }
+    return 0;
+}
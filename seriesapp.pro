@@ -5,24 +5,15 @@
 #-------------------------------------------------
 
 CONFIG += qt
-QT     += core gui widgets network
+QT     += core gui widgets network concurrent
 
 TARGET = seriesapp
 TEMPLATE = app
 
-INCLUDEPATH += src
-
-HEADERS  += \
-    src/mainwindow.h
+include(src/seriesapp.pri)
 
 SOURCES += \
-    src/main.cpp \
-    src/mainwindow.cpp
-
-FORMS    += \
-    src/mainwindow.ui
-
-RESOURCES += res/icons.qrc
+    src/main.cpp
 
 # For Windows exe icon
 win32:RC_FILE += res/windowsicon.rc
@@ -0,0 +1,138 @@
+#include "episodecachestore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#define EPISODECACHESTORE_MAGIC 0x53454543 // "SEEC"
+#define EPISODECACHESTORE_VERSION 1
+
+EpisodeCacheStore::EpisodeCacheStore() :
+    FileStore(EPISODECACHESTORE_MAGIC, EPISODECACHESTORE_VERSION)
+{
+}
+
+EpisodeCacheStore::~EpisodeCacheStore()
+{
+    saveIfChanged();
+}
+
+/* Records that the cache file was just written with the specified size. */
+void EpisodeCacheStore::setFile(QString cacheFile, qint64 size)
+{
+    Entry &entry = files[cacheFile];
+    entry.size = size;
+    entry.lastUsed = QDateTime::currentDateTimeUtc();
+    changed();
+}
+
+/* Records that the cache file was just used, if it is known. */
+void EpisodeCacheStore::touch(QString cacheFile)
+{
+    QHash<QString, Entry>::iterator it = files.find(cacheFile);
+    if (it == files.end()) { return; }
+    it->lastUsed = QDateTime::currentDateTimeUtc();
+    changed();
+}
+
+void EpisodeCacheStore::remove(QString cacheFile)
+{
+    if (files.remove(cacheFile)) {
+        changed();
+    }
+}
+
+/* Adds cache files found by scan() that are not known yet. */
+void EpisodeCacheStore::merge(const QHash<QString, Entry> &found)
+{
+    QHash<QString, Entry>::const_iterator it;
+    for (it = found.constBegin(); it != found.constEnd(); ++it) {
+        if (!files.contains(it.key())) {
+            files.insert(it.key(), it.value());
+        }
+    }
+    complete = true;
+    changed();
+}
+
+QHash<QString, EpisodeCacheStore::Entry> EpisodeCacheStore::entries() const
+{
+    return files;
+}
+
+void EpisodeCacheStore::clear()
+{
+    files.clear();
+    complete = false;
+}
+
+void EpisodeCacheStore::read(QDataStream &in)
+{
+    // Name length, size and date time
+    readItems(in, 4 + 8 + 13, [&]() {
+        QString cacheFile;
+        Entry entry;
+        in >> cacheFile >> entry.size >> entry.lastUsed;
+        files.insert(cacheFile, entry);
+    });
+    complete = true;
+}
+
+void EpisodeCacheStore::write(QDataStream &out) const
+{
+    out << qint32(files.count());
+    QHash<QString, Entry>::const_iterator it;
+    for (it = files.constBegin(); it != files.constEnd(); ++it) {
+        out << it.key() << it->size << it->lastUsed;
+    }
+}
+
+/* Saving a store that does not know all files would keep the others from
+ * ever being found, as the directory is only scanned when there is no file. */
+bool EpisodeCacheStore::writeChanges()
+{
+    if (!complete) { return false; }
+    return writeAll();
+}
+
+/* Returns the episode cache files in the directory, with their modification
+ * time as last use. Only needed once, when there is no store file yet. May be
+ * run outside the GUI thread. */
+QHash<QString, EpisodeCacheStore::Entry> EpisodeCacheStore::scan(QString dir)
+{
+    QHash<QString, Entry> found;
+    QFileInfoList infos = QDir(dir).entryInfoList(QStringList() << "epscache_*.txt",
+                                                  QDir::Files);
+    foreach (QFileInfo info, infos) {
+        Entry entry;
+        entry.size = info.size();
+        entry.lastUsed = info.lastModified().toUTC();
+        found.insert(info.fileName(), entry);
+    }
+    return found;
+}
+
+/* Removes the cache files from the directory, except those written again
+ * since their entries were recorded. May be run outside the GUI thread. */
+void EpisodeCacheStore::removeFiles(QString dir, QHash<QString, Entry> files)
+{
+    QDir d(dir);
+    QHash<QString, Entry>::const_iterator it;
+    for (it = files.constBegin(); it != files.constEnd(); ++it) {
+        QFileInfo info(d.filePath(it.key()));
+        if ((info.size() != it->size)
+                || (info.lastModified().toUTC() > it->lastUsed)) {
+            continue;
+        }
+        QFile::remove(info.filePath());
+    }
+}
+
+/* Returns the id of the series of a cache file named
+ * epscache_<maze>_<rage>_<directory>.txt */
+QString EpisodeCacheStore::seriesId(QString cacheFile)
+{
+    QStringList parts = cacheFile.split("_");
+    return parts.value(1) + "_" + parts.value(2);
+}
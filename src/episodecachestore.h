@@ -0,0 +1,51 @@
+#ifndef EPISODECACHESTORE_H
+#define EPISODECACHESTORE_H
+
+
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+
+#include "filestore.h"
+
+
+/* Keeps the size and last use of each episode cache file, so that the least
+ * recently used ones can be found without scanning the settings directory.
+ * Files are identified by their name, relative to the settings directory.
+ * Until the store is loaded from file or the files found by a scan are merged
+ * in, it only knows some of the files and is not saved. */
+class EpisodeCacheStore : public FileStore
+{
+public:
+    struct Entry
+    {
+        qint64 size = 0;
+        QDateTime lastUsed;
+    };
+
+    EpisodeCacheStore();
+    ~EpisodeCacheStore();
+
+    void setFile(QString cacheFile, qint64 size);
+    void touch(QString cacheFile);
+    void remove(QString cacheFile);
+    void merge(const QHash<QString, Entry> &found);
+    QHash<QString, Entry> entries() const;
+
+    static QHash<QString, Entry> scan(QString dir);
+    static void removeFiles(QString dir, QHash<QString, Entry> files);
+    static QString seriesId(QString cacheFile);
+
+protected:
+    void clear() override;
+    void read(QDataStream &in) override;
+    void write(QDataStream &out) const override;
+    bool writeChanges() override;
+
+private:
+    QHash<QString, Entry> files;
+    bool complete = false;      // Whether all cache files are known
+};
+
+
+#endif // EPISODECACHESTORE_H
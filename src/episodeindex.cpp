@@ -0,0 +1,251 @@
+#include "episodeindex.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+#define EPISODEINDEX_MAGIC 0x53455049 // "SEPI"
+#define EPISODEINDEX_VERSION 2
+
+// Replaced segments allowed in the file beyond one per series before it is
+// written again
+#define EPISODEINDEX_SPARE_SEGMENTS 16
+
+EpisodeIndex::EpisodeIndex() :
+    FileStore(EPISODEINDEX_MAGIC, EPISODEINDEX_VERSION)
+{
+}
+
+EpisodeIndex::~EpisodeIndex()
+{
+    saveIfChanged();
+}
+
+/* Replaces the indexed episodes of a series with the specified ones. */
+void EpisodeIndex::setSeriesEpisodes(QString seriesId, QList<Episode> episodes)
+{
+    replaceSeries(seriesId, episodes);
+    unsaved.insert(seriesId);
+    changed();
+}
+
+void EpisodeIndex::removeSeries(QString seriesId)
+{
+    if (!series.contains(seriesId)) { return; }
+    replaceSeries(seriesId, QList<Episode>());
+    unsaved.insert(seriesId);
+    changed();
+}
+
+/* Replaces the episodes of a series, and its postings once they are built.
+ * No episodes removes it. */
+void EpisodeIndex::replaceSeries(QString seriesId, const QList<Episode> &episodes)
+{
+    QList<Episode> old = series.take(seriesId);
+    if (indexed) {
+        removePostings(seriesId, old);
+        addPostings(seriesId, episodes);
+    }
+    if (!episodes.isEmpty()) {
+        series.insert(seriesId, episodes);
+    }
+}
+
+void EpisodeIndex::addPostings(QString seriesId, const QList<Episode> &episodes)
+{
+    for (int i=0; i < episodes.count(); i++) {
+        foreach (QString term, tokenize(episodes[i].second)) {
+            postings[term].insert(Posting(seriesId, i));
+        }
+    }
+}
+
+void EpisodeIndex::removePostings(QString seriesId, const QList<Episode> &episodes)
+{
+    for (int i=0; i < episodes.count(); i++) {
+        foreach (QString term, tokenize(episodes[i].second)) {
+            QHash<QString, QSet<Posting> >::iterator it = postings.find(term);
+            if (it == postings.end()) { continue; }
+            it->remove(Posting(seriesId, i));
+            if (it->isEmpty()) {
+                postings.erase(it);
+            }
+        }
+    }
+}
+
+/* Returns episodes of which the title contains all words of the query, best
+ * matches first. Exact title matches rank highest, followed by titles starting
+ * with or containing the query as a phrase, then shorter titles. */
+QList<EpisodeIndexHit> EpisodeIndex::search(QString query, int maxHits)
+{
+    QList<EpisodeIndexHit> hits;
+
+    QStringList terms = tokenize(query);
+    if (terms.isEmpty()) { return hits; }
+
+    if (!indexed) {
+        QHash<QString, QList<Episode> >::const_iterator it;
+        for (it = series.constBegin(); it != series.constEnd(); ++it) {
+            addPostings(it.key(), it.value());
+        }
+        indexed = true;
+    }
+
+    // Intersect postings, starting with the smallest set
+    QList<const QSet<Posting>*> sets;
+    foreach (QString term, terms) {
+        QHash<QString, QSet<Posting> >::const_iterator it = postings.constFind(term);
+        if (it == postings.constEnd()) { return hits; }
+        sets.append(&it.value());
+    }
+    std::sort(sets.begin(), sets.end(),
+              [](const QSet<Posting>* a, const QSet<Posting>* b) {
+        return a->count() < b->count();
+    });
+    QSet<Posting> matches = *sets.first();
+    for (int i=1; i < sets.count(); i++) {
+        matches.intersect(*sets[i]);
+    }
+
+    QString phrase = query.simplified().toLower();
+    foreach (Posting p, matches) {
+        const Episode &ep = series.value(p.first).at(p.second);
+        QString title = ep.second.toLower();
+
+        EpisodeIndexHit hit;
+        hit.seriesId = p.first;
+        hit.number = ep.first;
+        hit.title = ep.second;
+        if (title == phrase) {
+            hit.score = 3;
+        } else if (title.startsWith(phrase)) {
+            hit.score = 2;
+        } else if (title.contains(phrase)) {
+            hit.score = 1;
+        } else {
+            hit.score = 0;
+        }
+        hits.append(hit);
+    }
+
+    std::sort(hits.begin(), hits.end(),
+              [](const EpisodeIndexHit &a, const EpisodeIndexHit &b) {
+        if (a.score != b.score) { return a.score > b.score; }
+        if (a.title.count() != b.title.count()) {
+            return a.title.count() < b.title.count();
+        }
+        if (a.seriesId != b.seriesId) { return a.seriesId < b.seriesId; }
+        return a.number < b.number;
+    });
+
+    return hits.mid(0, maxHits);
+}
+
+void EpisodeIndex::clear()
+{
+    series.clear();
+    postings.clear();
+    indexed = false;
+    unsaved.clear();
+    segments = 0;
+    rewrite = true;
+}
+
+/* Reads the segments in file order, so that later ones replace earlier ones
+ * of the same series. A segment with no episodes removes the series. */
+void EpisodeIndex::read(QDataStream &in)
+{
+    while (!in.atEnd()) {
+        QString seriesId;
+        in >> seriesId;
+
+        // Number and title lengths
+        int count = readCount(in, 4 + 4);
+        QList<Episode> episodes;
+        for (int i=0; (i < count) && (in.status() == QDataStream::Ok); i++) {
+            Episode episode;
+            in >> episode.first >> episode.second;
+            episodes.append(episode);
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            // Last segment is incomplete, e.g. if the application stopped
+            // while appending it. Keep the complete ones and write the file
+            // again on the next save.
+            in.resetStatus();
+            return;
+        }
+        replaceSeries(seriesId, episodes);
+        segments++;
+    }
+    rewrite = false;
+}
+
+void EpisodeIndex::write(QDataStream &out) const
+{
+    QHash<QString, QList<Episode> >::const_iterator it;
+    for (it = series.constBegin(); it != series.constEnd(); ++it) {
+        writeSegment(out, it.key());
+    }
+}
+
+void EpisodeIndex::writeSegment(QDataStream &out, QString seriesId) const
+{
+    QList<Episode> episodes = series.value(seriesId);
+    out << seriesId << qint32(episodes.count());
+    foreach (Episode episode, episodes) {
+        out << episode.first << episode.second;
+    }
+}
+
+/* Appends a segment for each series changed since the last save. The whole
+ * file is written instead if it is not valid or mostly consists of replaced
+ * segments. */
+bool EpisodeIndex::writeChanges()
+{
+    int limit = 2 * series.count() + EPISODEINDEX_SPARE_SEGMENTS;
+    if (!rewrite && (segments + unsaved.count() <= limit)) {
+        QFile file(fileName());
+        if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            QDataStream out(&file);
+            foreach (QString seriesId, unsaved) {
+                writeSegment(out, seriesId);
+            }
+            if ((out.status() == QDataStream::Ok) && file.flush()) {
+                segments += unsaved.count();
+                unsaved.clear();
+                return true;
+            }
+        }
+        // The file may now end with an incomplete segment
+    }
+
+    if (!writeAll()) {
+        rewrite = true;
+        return false;
+    }
+    segments = series.count();
+    unsaved.clear();
+    rewrite = false;
+    return true;
+}
+
+/* Splits text into lowercase words of letters and digits. */
+QStringList EpisodeIndex::tokenize(QString text)
+{
+    QStringList words;
+    QString word;
+    foreach (QChar c, text) {
+        if (c.isLetterOrNumber()) {
+            word += c.toLower();
+        } else if (!word.isEmpty()) {
+            words.append(word);
+            word.clear();
+        }
+    }
+    if (!word.isEmpty()) {
+        words.append(word);
+    }
+    return words;
+}
@@ -0,0 +1,68 @@
+#ifndef EPISODEINDEX_H
+#define EPISODEINDEX_H
+
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "filestore.h"
+
+
+struct EpisodeIndexHit
+{
+    QString seriesId;
+    QString number;
+    QString title;
+    int score;
+};
+
+/* Inverted index of episode titles of all cached series. Each word of a title
+ * maps to the (series id, episode) pairs whose title contains it. The index is
+ * updated per series whenever an episode list is saved to cache. The file
+ * holds a segment with the episodes of each series; changed series are
+ * appended as new segments, replacing earlier ones when loaded, and the file
+ * is only written again once most of its segments have been replaced. Only
+ * the episodes are loaded at startup; the words are indexed on the first
+ * search. */
+class EpisodeIndex : public FileStore
+{
+public:
+    typedef QPair<QString, QString> Episode; // Number and title
+    typedef QPair<QString, int> Posting;     // Series id and episode index
+
+    EpisodeIndex();
+    ~EpisodeIndex();
+
+    void setSeriesEpisodes(QString seriesId, QList<Episode> episodes);
+    void removeSeries(QString seriesId);
+    QList<EpisodeIndexHit> search(QString query, int maxHits = 200);
+
+    static QStringList tokenize(QString text);
+
+protected:
+    void clear() override;
+    void read(QDataStream &in) override;
+    void write(QDataStream &out) const override;
+    bool writeChanges() override;
+
+private:
+    QHash<QString, QList<Episode> > series;
+    QHash<QString, QSet<Posting> > postings;
+    bool indexed = false;       // Whether postings are built
+
+    QSet<QString> unsaved;      // Series changed since the last save
+    int segments = 0;           // Segments in the file, including replaced ones
+    bool rewrite = true;        // Whether the file has to be written again
+
+    void replaceSeries(QString seriesId, const QList<Episode> &episodes);
+    void addPostings(QString seriesId, const QList<Episode> &episodes);
+    void removePostings(QString seriesId, const QList<Episode> &episodes);
+    void writeSegment(QDataStream &out, QString seriesId) const;
+};
+
+
+#endif // EPISODEINDEX_H
@@ -0,0 +1,303 @@
+#ifndef EPISODEPARSER_H
+#define EPISODEPARSER_H
+
+
+#include <QDate>
+#include <QLocale>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTextDocument>
+
+
+struct Series
+{
+    /* If decode is false, HTML escape sequences in the name are not decoded.
+     * This allows parsing outside the GUI thread, as decodeHtml() uses
+     * QTextDocument. */
+    Series(QString txt, bool decode = true)
+    {
+        rawText = txt;
+        if (!txt.startsWith('"')) {
+            valid = false;
+            return;
+        }
+        valid = true;
+
+        QStringList cols = rawTextToColumns(txt);
+
+        // Series name
+        name = cols.value(0);
+        // Remove quotes
+        name.remove(0, 1);
+        name.remove(name.count()-1, 1);
+
+        if (decode) {
+            name = decodeHtml(name);
+        }
+        // Names with escape sequences get a new key once they are decoded
+        searchKey = makeSearchKey(name);
+
+        // Series Rage code
+        rageNo = cols.value(2);
+
+        // Series Maze code
+        mazeNo = cols.value(3);
+
+        // Unique series id, used as key in maps and sets
+        id = QString("%1_%2").arg(mazeNo).arg(rageNo);
+
+        // Series directory
+        directory = cols.value(1);
+
+        // Series start date
+        date = cols.value(4);
+        // Simplify date to account for double spaces
+        year = date.simplified().split(" ").value(1).toInt();
+
+        // Series end date, empty if still running
+        endDate = cols.value(5);
+        endYear = endDate.simplified().split(" ").value(1).toInt();
+    }
+
+    bool ended() const { return endYear > 0; }
+
+    bool valid;
+    QString rawText;
+    QString name;
+    QString searchKey;          // Name folded for searching, see makeSearchKey()
+    QString rageNo;
+    QString mazeNo;
+    QString id;
+    QString directory;
+    QString date;
+    int year;
+    QString endDate;
+    int endYear;
+    int index = -1;             // Position in MainWindow::seriesList
+
+    static QStringList rawTextToColumns(QString txt)
+    {
+        QStringList cols;
+
+        QString col;
+        bool inQuotes = false;
+        for (int i=0; i < txt.count(); i++) {
+            QChar c = txt.at(i);
+            if (c == '"') {
+                inQuotes = !inQuotes;
+                col += c;
+            } else if (c == ',') {
+                if (inQuotes) {
+                    col += c;
+                } else {
+                    cols.append(col);
+                    col.clear();
+                    inQuotes = false;
+                }
+            } else {
+                col += c;
+            }
+        }
+        cols.append(col);
+
+        return cols;
+    }
+
+    /* Returns the text folded for searching: in lower case, without
+     * diacritics, with apostrophes and periods removed, other punctuation and
+     * symbols turned into spaces and whitespace collapsed. "Marvel's Agents of
+     * S.H.I.E.L.D." becomes "marvels agents of shield" and "Pokémon" becomes
+     * "pokemon". */
+    static QString makeSearchKey(const QString &text)
+    {
+        QString decomposed = text.normalized(QString::NormalizationForm_KD);
+        QString key;
+        key.reserve(decomposed.count());
+        bool space = false;
+        foreach (QChar c, decomposed) {
+            if (c.isLetterOrNumber()) {
+                if (space && !key.isEmpty()) {
+                    key += ' ';
+                }
+                space = false;
+                key += c.toLower();
+            } else if (c.isMark()) {
+                // Diacritic split off the letter by the decomposition
+            } else if ((c == '\'') || (c == '.') || (c == QChar(0x2019))) {
+                // Dropped, so that "marvels" and "shield" match
+            } else {
+                space = true;
+            }
+        }
+        return key;
+    }
+
+    static QString decodeHtml(QString html)
+    {
+        // Most names contain no markup. Skip the expensive QTextDocument for
+        // those, only collapsing whitespace like the HTML parser would.
+        if (!html.contains('&') && !html.contains('<')) {
+            return html.simplified();
+        }
+        QTextDocument t;
+        t.setHtml(html);
+        return t.toPlainText();
+    }
+};
+typedef QSharedPointer<Series> SeriesPtr;
+struct Episode
+{
+    SeriesPtr series;
+    QString rawText;
+    QString name;
+    QString number;
+    int seasonNo = 0;
+    int episodeNo = 0;
+    int ordinal = 0;            // Overall episode number, 0 for specials
+    bool special = false;
+    QDate date;
+};
+typedef QSharedPointer<Episode> EpisodePtr;
+
+// Episode list formats, depending on whether the maze or rage number was used
+enum EpisodeSchema
+{
+    EpisodeSchemaMaze,
+    EpisodeSchemaRage
+};
+
+template<EpisodeSchema schema> struct EpisodeColumns;
+
+template<> struct EpisodeColumns<EpisodeSchemaMaze>
+{
+    // number,season,episode,airdate,title,tvmaze link
+    // 1,1,1,01 Oct 06,"Dexter","https://www.tvmaze.com/episodes/11596/dexter-1x01-dexter"
+    enum { Date = 3, Name = 4, Count = 5 };
+
+    static QDate toDate(const QString &dateRaw)
+    {
+        static const QLocale locale(QLocale::English, QLocale::UnitedStates);
+        return locale.toDate(dateRaw, "dd MMM yy");
+    }
+};
+
+template<> struct EpisodeColumns<EpisodeSchemaRage>
+{
+    // number,season,episode,production code,airdate,title,special?,tvrage
+    // 1,1,1,"",9/Jun/89,"Pilot",n
+    enum { Date = 4, Name = 5, Count = 6 };
+
+    static QDate toDate(const QString &dateRaw)
+    {
+        static const QLocale locale(QLocale::English, QLocale::UnitedStates);
+        QDate date = locale.toDate(dateRaw, "d/MMM/yy");
+        if (!date.isValid()) {
+            date = locale.toDate(dateRaw, "dd/MMM/yy");
+        }
+        return date;
+    }
+};
+
+/* Parses an episode line of the specified schema. Returns null if the line is
+ * not an episode or has too few columns. */
+template<EpisodeSchema schema>
+EpisodePtr parseEpisode(const QString &txt, SeriesPtr parentSeries)
+{
+    typedef EpisodeColumns<schema> Cols;
+
+    // Episode lines start with the episode number, or S for specials
+    if (txt.isEmpty()) { return EpisodePtr(); }
+    QChar first = txt.at(0);
+    if (!first.isDigit() && (first != 'S')) { return EpisodePtr(); }
+
+    QStringList cols = Series::rawTextToColumns(txt);
+    if (cols.count() < Cols::Count) { return EpisodePtr(); }
+
+    EpisodePtr ep(new Episode());
+    ep->rawText = txt;
+    ep->series = parentSeries;
+
+    // Episode name
+    QString name = cols.at(Cols::Name);
+    // Remove quotes
+    name.remove(0, 1);
+    name.remove(name.count()-1, 1);
+    ep->name = Series::decodeHtml(name);
+
+    ep->seasonNo = cols.at(1).toInt();
+    ep->episodeNo = cols.at(2).toInt();
+    ep->special = (first == 'S');
+    ep->ordinal = ep->special ? 0 : cols.at(0).toInt();
+
+    // Episode number
+    QString number = cols.at(2);
+    if (number.length() == 1) { number.prepend("0"); }
+    number.prepend(cols.at(1)); // Season number
+    if (ep->special) {
+        number.prepend("S");
+    }
+    ep->number = number;
+
+    // Episode date. Simplify to account for double spaces
+    ep->date = Cols::toDate(cols.at(Cols::Date).simplified());
+    if (ep->date.year() < parentSeries->year) {
+        ep->date = ep->date.addYears(100);
+    }
+
+    return ep;
+}
+
+/* Parses the lines of one episode list. The schema is taken from the header
+ * line if there is one (downloads), otherwise from the series numbers (cache
+ * files). The parser for the schema is chosen once, not for every line. */
+class EpisodeListParser
+{
+public:
+    explicit EpisodeListParser(SeriesPtr series) : series(series)
+    {
+        setSchema(series->mazeNo.isEmpty() ? EpisodeSchemaRage : EpisodeSchemaMaze);
+    }
+
+    /* Returns the episode, or null if the line is not a valid episode. */
+    EpisodePtr parseLine(const QString &line)
+    {
+        EpisodePtr ep = parseFn(line, series);
+        if (ep) { return ep; }
+
+        if (line.startsWith("number,")) {
+            // Header line naming the columns
+            if (line.contains("tvmaze")) {
+                setSchema(EpisodeSchemaMaze);
+            } else if (line.contains("tvrage") || line.contains("production code")) {
+                setSchema(EpisodeSchemaRage);
+            }
+        } else if (!line.trimmed().isEmpty()) {
+            if (invalidLines == 0) {
+                firstInvalidLine = line.trimmed();
+            }
+            invalidLines++;
+        }
+        return ep;
+    }
+
+    // Non-empty lines that were not episodes, other than the header
+    int invalidLines = 0;
+    QString firstInvalidLine;
+
+private:
+    SeriesPtr series;
+    EpisodePtr (*parseFn)(const QString &txt, SeriesPtr parentSeries);
+
+    void setSchema(EpisodeSchema schema)
+    {
+        if (schema == EpisodeSchemaMaze) {
+            parseFn = &parseEpisode<EpisodeSchemaMaze>;
+        } else {
+            parseFn = &parseEpisode<EpisodeSchemaRage>;
+        }
+    }
+};
+
+
+#endif // EPISODEPARSER_H
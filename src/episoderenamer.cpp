@@ -0,0 +1,202 @@
+#include "episoderenamer.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+/* Finds media and subtitle files with season and episode tokens in their names
+ * in the directory tree. Subdirectories are scanned in parallel. The new paths
+ * of the returned items are empty. */
+QList<RenameItem> EpisodeRenamer::scan(QString dir)
+{
+    QList<RenameItem> items = scanFiles(dir, false);
+
+    QDir top(dir);
+    QStringList subdirs;
+    foreach (QString name, top.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        subdirs.append(top.filePath(name));
+    }
+    QList< QList<RenameItem> > trees =
+            QtConcurrent::blockingMapped< QList< QList<RenameItem> > >(subdirs, scanTree);
+    foreach (QList<RenameItem> tree, trees) {
+        items.append(tree);
+    }
+
+    std::sort(items.begin(), items.end(),
+              [](const RenameItem &a, const RenameItem &b) {
+        return a.oldPath < b.oldPath;
+    });
+    return items;
+}
+
+QList<RenameItem> EpisodeRenamer::scanTree(const QString &dir)
+{
+    return scanFiles(dir, true);
+}
+
+QList<RenameItem> EpisodeRenamer::scanFiles(const QString &dir, bool recursive)
+{
+    static const QStringList filters = QStringList()
+            << "*.mkv" << "*.mp4" << "*.m4v" << "*.avi" << "*.mov" << "*.wmv"
+            << "*.mpg" << "*.mpeg" << "*.ts" << "*.webm"
+            << "*.srt" << "*.sub" << "*.idx" << "*.ass" << "*.ssa";
+
+    // Tokens like S01E02, s01.e02 and 1x02
+    QRegularExpression seRegex("(?:^|[^a-z0-9])s(\\d{1,2})[ ._-]?e(\\d{1,3})",
+                               QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression xRegex("(?:^|[^0-9])(\\d{1,2})x(\\d{2,3})(?:[^0-9]|$)",
+                              QRegularExpression::CaseInsensitiveOption);
+
+    QList<RenameItem> items;
+    QDirIterator it(dir, filters, QDir::Files,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QString name = it.fileInfo().completeBaseName();
+
+        QRegularExpressionMatch m = seRegex.match(name);
+        if (!m.hasMatch()) {
+            m = xRegex.match(name);
+        }
+        if (!m.hasMatch()) { continue; }
+
+        RenameItem item;
+        item.oldPath = path;
+        item.season = m.captured(1).toInt();
+        item.episode = m.captured(2).toInt();
+        items.append(item);
+    }
+    return items;
+}
+
+/* Sets the new path of each item to the name of its episode, keeping the
+ * directory and extension. Items without a matching episode, that are already
+ * named correctly or whose new name is already taken are left out. */
+QList<RenameItem> EpisodeRenamer::match(QList<RenameItem> items,
+                                        QHash<EpisodeKey, QString> names)
+{
+    QList<RenameItem> matched;
+    QSet<QString> targets;
+
+    foreach (RenameItem item, items) {
+        QHash<EpisodeKey, QString>::const_iterator it =
+                names.constFind(EpisodeKey(item.season, item.episode));
+        if (it == names.constEnd()) { continue; }
+
+        QFileInfo info(item.oldPath);
+        item.newPath = info.dir().filePath(it.value() + "." + info.suffix());
+        if (item.newPath == item.oldPath) { continue; }
+        if (targets.contains(item.newPath) || QFileInfo::exists(item.newPath)) {
+            continue;
+        }
+
+        targets.insert(item.newPath);
+        matched.append(item);
+    }
+
+    return matched;
+}
+
+/* Renames all items, or none of them: if one fails, the ones already renamed
+ * are renamed back. The renames are written to the undo log before any file
+ * is touched. If some cannot be renamed back, the undo log is left with just
+ * those. Returns an empty string on success, otherwise the error. */
+QString EpisodeRenamer::rename(QList<RenameItem> items, QString undoLogFile)
+{
+    if (!writeUndoLog(items, undoLogFile)) {
+        return "Could not write undo log " + undoLogFile;
+    }
+
+    for (int i=0; i < items.count(); i++) {
+        if (!QFile::rename(items[i].oldPath, items[i].newPath)) {
+            QString error = QString("Could not rename %1 to %2")
+                    .arg(items[i].oldPath).arg(items[i].newPath);
+            // Roll back
+            QList<RenameItem> stuck;
+            for (int j=i-1; j >= 0; j--) {
+                if (!QFile::rename(items[j].newPath, items[j].oldPath)) {
+                    stuck.prepend(items[j]);
+                }
+            }
+            if (stuck.isEmpty()) {
+                QFile::remove(undoLogFile);
+                return error;
+            }
+
+            // Keep the renames not rolled back so that they can be undone
+            // later. The log still lists them all if it cannot be rewritten.
+            writeUndoLog(stuck, undoLogFile);
+            QStringList paths;
+            foreach (RenameItem item, stuck) {
+                paths.append(item.newPath);
+            }
+            return error + QString(", and could not rename %1 files back: %2")
+                    .arg(stuck.count()).arg(paths.join(", "));
+        }
+    }
+
+    return QString();
+}
+
+/* Writes the renames to the undo log, replacing it only once complete. */
+bool EpisodeRenamer::writeUndoLog(const QList<RenameItem> &items, QString undoLogFile)
+{
+    QSaveFile log(undoLogFile);
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    foreach (RenameItem item, items) {
+        log.write((item.newPath + "\t" + item.oldPath + "\n").toUtf8());
+    }
+    return log.commit();
+}
+
+/* Renames the files of the last batch back to their old names. The undo log is
+ * kept if some could not be renamed, so that it can be tried again. Returns an
+ * empty string on success, otherwise the error. */
+QString EpisodeRenamer::undo(QString undoLogFile)
+{
+    QFile log(undoLogFile);
+    if (!log.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return "Nothing to undo";
+    }
+    QList<QByteArray> lines = log.readAll().split('\n');
+    log.close();
+
+    int failed = 0;
+    for (int i=lines.count() - 1; i >= 0; i--) {
+        QStringList paths = QString::fromUtf8(lines[i]).split('\t');
+        if (paths.count() != 2) { continue; }
+        // Already renamed back, or never renamed
+        if (!QFile::exists(paths[0])) { continue; }
+        if (!QFile::rename(paths[0], paths[1])) {
+            failed++;
+        }
+    }
+
+    if (failed) {
+        return QString("Could not undo %1 renames").arg(failed);
+    }
+    log.remove();
+    return QString();
+}
+
+/* Removes characters not allowed in file names on common file systems. */
+QString EpisodeRenamer::safeFileName(QString name)
+{
+    static const QString invalid = "\\/:*?\"<>|";
+    QString safe;
+    foreach (QChar c, name) {
+        if (!invalid.contains(c) && (c >= ' ')) {
+            safe += c;
+        }
+    }
+    return safe.simplified();
+}
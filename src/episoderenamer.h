@@ -0,0 +1,43 @@
+#ifndef EPISODERENAMER_H
+#define EPISODERENAMER_H
+
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+
+struct RenameItem
+{
+    QString oldPath;
+    QString newPath;
+    int season = 0;
+    int episode = 0;
+};
+
+/* Renames media files in a directory tree to episode names. Files are matched
+ * to episodes by season and episode tokens in their names, such as S01E02 or
+ * 1x02. All functions may be run outside the GUI thread. */
+class EpisodeRenamer
+{
+public:
+    typedef QPair<int, int> EpisodeKey; // Season and episode number
+
+    static QList<RenameItem> scan(QString dir);
+    static QList<RenameItem> match(QList<RenameItem> items,
+                                   QHash<EpisodeKey, QString> names);
+    static QString rename(QList<RenameItem> items, QString undoLogFile);
+    static QString undo(QString undoLogFile);
+
+    static QString safeFileName(QString name);
+
+private:
+    static QList<RenameItem> scanTree(const QString &dir);
+    static QList<RenameItem> scanFiles(const QString &dir, bool recursive);
+    static bool writeUndoLog(const QList<RenameItem> &items, QString undoLogFile);
+};
+
+
+#endif // EPISODERENAMER_H
@@ -0,0 +1,131 @@
+#include "filestore.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+// Delay after the last change before the file is written
+#define FILESTORE_SAVE_DELAY_MS 2000
+
+FileStore::FileStore(quint32 magic, qint32 version) :
+    magic(magic),
+    version(version)
+{
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(FILESTORE_SAVE_DELAY_MS);
+    QObject::connect(&saveTimer, &QTimer::timeout, &saveTimer, [this]() {
+        save();
+    });
+}
+
+FileStore::~FileStore()
+{
+}
+
+/* Loads the store from file. Returns false and leaves the store empty if the
+ * file doesn't exist or is not valid. Changes are saved to the same file. */
+bool FileStore::load(QString filename)
+{
+    this->filename = filename;
+    clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    if (!checkHeader(in)) {
+        return false;
+    }
+    read(in);
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool FileStore::save()
+{
+    saveTimer.stop();
+    if (filename.isEmpty()) { return false; }
+
+    if (!writeChanges()) {
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+/* Returns a number that changes whenever the data changes. */
+int FileStore::revision() const
+{
+    return changes;
+}
+
+void FileStore::changed()
+{
+    changes++;
+    dirty = true;
+    saveTimer.start();
+}
+
+void FileStore::saveIfChanged()
+{
+    if (dirty) {
+        save();
+    }
+}
+
+/* Writes the changes since the last save. By default, the whole file is
+ * written again. */
+bool FileStore::writeChanges()
+{
+    return writeAll();
+}
+
+bool FileStore::writeAll()
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << magic << version;
+    write(out);
+
+    return file.commit();
+}
+
+/* Reads the number of items that follow, each of which takes at least
+ * itemSize bytes. The count read from the file is not trusted: if it is
+ * negative or more than the rest of the file can hold, the stream status is
+ * set to corrupt data and 0 is returned. */
+int FileStore::readCount(QDataStream &in, int itemSize)
+{
+    qint32 count = 0;
+    in >> count;
+    if (in.status() != QDataStream::Ok) { return 0; }
+
+    qint64 available = in.device() ? in.device()->bytesAvailable() : 0;
+    if ((count < 0) || (qint64(count) * qMax(1, itemSize) > available)) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return 0;
+    }
+    return count;
+}
+
+QString FileStore::fileName() const
+{
+    return filename;
+}
+
+bool FileStore::checkHeader(QDataStream &in) const
+{
+    quint32 fileMagic = 0;
+    qint32 fileVersion = 0;
+    in >> fileMagic >> fileVersion;
+    return (fileMagic == magic) && (fileVersion == version);
+}
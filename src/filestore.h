@@ -0,0 +1,65 @@
+#ifndef FILESTORE_H
+#define FILESTORE_H
+
+
+#include <QDataStream>
+#include <QString>
+#include <QTimer>
+
+
+/* Base of the stores kept in one file in the settings directory. Subclasses
+ * only read and write their data and call changed() whenever it changes.
+ * Changes are written together shortly after the last one, to a file that
+ * replaces the old one once complete, after a magic number and format
+ * version. The data of a subclass is gone by the time the base destructor
+ * runs, so subclasses call saveIfChanged() in their own destructor. */
+class FileStore
+{
+public:
+    bool load(QString filename);
+    bool save();
+    int revision() const;
+
+protected:
+    FileStore(quint32 magic, qint32 version);
+    virtual ~FileStore();
+
+    void changed();
+    void saveIfChanged();
+
+    virtual void clear() = 0;
+    virtual void read(QDataStream &in) = 0;
+    virtual void write(QDataStream &out) const = 0;
+
+    virtual bool writeChanges();
+    bool writeAll();
+    QString fileName() const;
+
+    static int readCount(QDataStream &in, int itemSize);
+    template<typename ReadItem>
+    static void readItems(QDataStream &in, int itemSize, ReadItem readItem);
+
+private:
+    quint32 magic;
+    qint32 version;
+    QString filename;
+    bool dirty = false;
+    int changes = 0;
+    QTimer saveTimer;
+    bool checkHeader(QDataStream &in) const;
+};
+
+/* Reads a count followed by that many items, calling readItem() for each one,
+ * until the stream reports an error. The store is cleared by load() in that
+ * case, so items read before it need not be undone. */
+template<typename ReadItem>
+void FileStore::readItems(QDataStream &in, int itemSize, ReadItem readItem)
+{
+    int count = readCount(in, itemSize);
+    for (int i=0; (i < count) && (in.status() == QDataStream::Ok); i++) {
+        readItem();
+    }
+}
+
+
+#endif // FILESTORE_H
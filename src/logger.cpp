@@ -0,0 +1,183 @@
+#include "logger.h"
+
+#include <QFile>
+
+// Messages beyond this number per second are dropped
+#define LOGGER_MAX_PER_SECOND 50
+
+// Delay before pending messages are written to the log file
+#define LOGGER_FLUSH_DELAY_MS 1000
+
+Logger::Logger(int capacity)
+{
+    ring.resize(qMax(1, capacity));
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(LOGGER_FLUSH_DELAY_MS);
+    QObject::connect(&flushTimer, &QTimer::timeout, &flushTimer, [this]() {
+        flush();
+    });
+}
+
+Logger::~Logger()
+{
+    flush();
+}
+
+void Logger::log(LogLevel level, QString msg)
+{
+    // Collapse repeats of the previous message
+    if ((msg == lastMsg) && (level == lastLevel)) {
+        repeats++;
+        // Write the count even if no other message follows
+        startFlushTimer();
+        return;
+    }
+    addRepeats();
+    lastMsg = msg;
+    lastLevel = level;
+
+    // Limit the number of messages per second
+    QDateTime now = QDateTime::currentDateTime();
+    if (!windowStart.isValid() || (windowStart.msecsTo(now) >= 1000)) {
+        addSuppressed();
+        windowStart = now;
+        windowCount = 0;
+    }
+    if ((windowCount >= LOGGER_MAX_PER_SECOND) && (level != LogError)) {
+        suppressed++;
+        startFlushTimer();
+        return;
+    }
+    windowCount++;
+
+    add(level, msg);
+}
+
+QString Logger::repeatsMsg() const
+{
+    return QString("(previous message repeated %1 times)").arg(repeats);
+}
+
+/* Adds the number of repeats of the last message so far, if any. Further
+ * repeats are counted again from zero. */
+void Logger::addRepeats()
+{
+    if (!repeats) { return; }
+    add(lastLevel, repeatsMsg());
+    repeats = 0;
+}
+
+QString Logger::suppressedMsg() const
+{
+    return QString("%1 log messages suppressed").arg(suppressed);
+}
+
+/* Adds the number of messages dropped so far, if any. */
+void Logger::addSuppressed()
+{
+    if (!suppressed) { return; }
+    add(LogWarning, suppressedMsg());
+    suppressed = 0;
+}
+
+void Logger::add(LogLevel level, QString msg)
+{
+    Entry entry;
+    entry.time = QDateTime::currentDateTime();
+    entry.level = level;
+    entry.msg = msg;
+
+    // Overwrite the oldest entry once the ring is full
+    ring[(first + count) % ring.count()] = entry;
+    if (count < ring.count()) {
+        count++;
+    } else {
+        first = (first + 1) % ring.count();
+    }
+
+    if (!filename.isEmpty()) {
+        pending.append(format(entry));
+        startFlushTimer();
+    }
+}
+
+void Logger::startFlushTimer()
+{
+    if (!filename.isEmpty() && !flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+/* Returns the logged messages, oldest first, including the numbers of
+ * repeated and suppressed messages so far. */
+QStringList Logger::lines() const
+{
+    QStringList list;
+    for (int i=0; i < count; i++) {
+        list.append(format(ring.at((first + i) % ring.count())));
+    }
+    if (repeats) {
+        list.append(format(lastLevel, repeatsMsg()));
+    }
+    if (suppressed) {
+        list.append(format(LogWarning, suppressedMsg()));
+    }
+    return list;
+}
+
+/* Sets the file messages are written to, or none if filename is empty. Once
+ * the file exceeds maxSize, it is renamed to <filename>.1 and a new one is
+ * started. */
+void Logger::setFile(QString filename, qint64 maxSize)
+{
+    flush();
+    this->filename = filename;
+    this->maxSize = maxSize;
+}
+
+void Logger::flush()
+{
+    // Include the repeated and suppressed messages so far
+    if (!filename.isEmpty()) {
+        addRepeats();
+        addSuppressed();
+    }
+    flushTimer.stop();
+    if (pending.isEmpty()) { return; }
+    if (filename.isEmpty()) {
+        pending.clear();
+        return;
+    }
+
+    if (QFile(filename).size() > maxSize) {
+        QFile::remove(filename + ".1");
+        QFile::rename(filename, filename + ".1");
+    }
+
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        file.write((pending.join("\n") + "\n").toUtf8());
+        file.close();
+    }
+    pending.clear();
+}
+
+QString Logger::format(const Entry &entry)
+{
+    static const char* levels[] = {"debug", "info", "warning", "error"};
+    return QString("%1 %2: %3")
+            .arg(entry.time.toString("yyyy-MM-dd hh:mm:ss"))
+            .arg(levels[entry.level])
+            .arg(entry.msg);
+}
+
+/* Formats a message that is not in the ring yet, as if added now. */
+QString Logger::format(LogLevel level, QString msg)
+{
+    Entry entry;
+    entry.time = QDateTime::currentDateTime();
+    entry.level = level;
+    entry.msg = msg;
+    return format(entry);
+}
@@ -0,0 +1,74 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+
+enum LogLevel
+{
+    LogDebug,
+    LogInfo,
+    LogWarning,
+    LogError
+};
+
+/* Keeps the most recent log messages in a fixed-size ring buffer. Repeats of
+ * the same message are collapsed into one line, and messages other than errors
+ * beyond a maximum rate are dropped and counted. Optionally, messages are also
+ * written to a file, in batches, which is rotated once it gets too big. */
+class Logger
+{
+public:
+    explicit Logger(int capacity = 1000);
+    ~Logger();
+
+    void log(LogLevel level, QString msg);
+    QStringList lines() const;
+
+    void setFile(QString filename, qint64 maxSize = 1024 * 1024);
+
+private:
+    struct Entry
+    {
+        QDateTime time;
+        LogLevel level;
+        QString msg;
+    };
+    QVector<Entry> ring;
+    int first = 0;              // Index of oldest entry in ring
+    int count = 0;
+
+    // Collapsing of repeated messages
+    QString lastMsg;
+    LogLevel lastLevel = LogInfo;
+    int repeats = 0;
+    QString repeatsMsg() const;
+    void addRepeats();
+
+    // Rate limiting
+    QDateTime windowStart;
+    int windowCount = 0;
+    int suppressed = 0;
+    QString suppressedMsg() const;
+    void addSuppressed();
+
+    // File output
+    QString filename;
+    qint64 maxSize = 0;
+    QStringList pending;
+    QTimer flushTimer;
+    void flush();
+
+    void add(LogLevel level, QString msg);
+    void startFlushTimer();
+    static QString format(const Entry &entry);
+    static QString format(LogLevel level, QString msg);
+};
+
+
+#endif // LOGGER_H
@@ -4,8 +4,26 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // Optional search query, e.g. seriesapp "breaking bad"
+    QString query = a.arguments().mid(1).join(" ");
+
+    // Only one instance runs at a time. If there is one already, hand the
+    // query over to it instead of starting up again.
+    if (MainWindow::sendToRunningInstance("show " + query)) {
+        return 0;
+    }
+
     MainWindow w;
+    if (w.otherInstanceRunning) {
+        // Another instance started up at the same time as this one
+        MainWindow::sendToRunningInstance("show " + query);
+        return 0;
+    }
     w.show();
+    if (!query.isEmpty()) {
+        w.searchFor(query);
+    }
 
     return a.exec();
 }
@@ -2,6 +2,13 @@
 #include "ui_mainwindow.h"
 
 #include <QDesktopServices>
+#include <QFileDialog>
+#include <QScrollBar>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
 
 MainWindow::MainWindow(QWidget *parent) :
     QWidget(parent),
@@ -19,21 +26,62 @@ MainWindow::MainWindow(QWidget *parent) :
 
     ui->stackedWidget->setCurrentWidget(ui->page_main);
 
+    // Listen for other instances early, so they don't start up while this
+    // one is still loading. If another one has just started, this one does
+    // not load anything and main() hands over to the other one.
+    if (!startLocalServer()) {
+        otherInstanceRunning = true;
+        return;
+    }
+
     ui->pushButton_OpenSettingsFolder->setToolTip(getSettingsDir());
 
+    epListCache.setMaxCost(EPLIST_CACHE_MAX_EPISODES);
+
+    // Refresh the shown log at most a few times per second
+    logViewTimer.setSingleShot(true);
+    logViewTimer.setInterval(200);
+    connect(&logViewTimer, &QTimer::timeout, this, &MainWindow::updateLogView);
+
     // Try to load settings file
     if (loadSettingsFile()) {
         ui->label->setText("Loaded settings file.");
     }
+    if (logToFile) {
+        logger.setFile(getSettingsDir(LOG_FILENAME));
+    }
 
     setProxy();
     // Connect download manager signal
     connect(&manager, &QNetworkAccessManager::finished,
             this, &MainWindow::downloadFinished);
 
+    connect(&renameScanWatcher, &QFutureWatcherBase::finished,
+            this, &MainWindow::renameScanFinished);
+    connect(&renameWatcher, &QFutureWatcherBase::finished,
+            this, &MainWindow::renameFinished);
+    connect(&epCacheScanWatcher, &QFutureWatcherBase::finished,
+            this, &MainWindow::epCacheScanFinished);
+
+    // Episodes are shown in a tree grouped by season, instead of the list
+    ui->treeWidget_episodes->hide();
+    connect(ui->treeWidget_episodes, &QTreeWidget::itemChanged,
+            this, &MainWindow::episodeItemChanged);
+    connect(ui->treeWidget_episodes, &QTreeWidget::itemExpanded,
+            this, &MainWindow::episodeSeasonExpanded);
+
+    watched.load(getSettingsDir(WATCHED_FILENAME));
+
     // Load favourites from file
     loadFavListFile();
 
+    // Load episode title index and episode list summaries. If they don't
+    // exist yet, they are built from the episode caches once the series list
+    // is available. The titles are only indexed on the first episode search.
+    epIndexLoaded = epIndex.load(getSettingsDir(EPINDEX_FILENAME));
+    summariesLoaded = summaries.load(getSettingsDir(SUMMARIES_FILENAME));
+    epCachesLoaded = epCaches.load(getSettingsDir(EPCACHES_FILENAME));
+
     // Retrieve series list
     ui->label->setText("Loading list of all series...");
     // First try to load series list from file
@@ -42,6 +90,10 @@ MainWindow::MainWindow(QWidget *parent) :
         on_actionRe_download_seriesList_triggered();
     } else {
 
+        resolveFavourites();
+        buildCacheIndexes();
+        QTimer::singleShot(EPCACHE_CLEANUP_DELAY_MS, this, &MainWindow::cleanUpEpisodeCaches);
+
         // Get how old seriesList.txt is in days
         currentListAge = calculateDaysOld(seriesListInfo);
         QString lbl = "List loaded from seriesList.txt";
@@ -85,9 +137,156 @@ void MainWindow::addDaysOldString(QString &str, int days)
     }
 }
 
-void MainWindow::log(QString msg)
+void MainWindow::log(QString msg, LogLevel level)
 {
-    ui->textBrowser_ErrorLog->append(msg);
+    logger.log(level, msg);
+    if (ui->stackedWidget->currentWidget() == ui->page_settings) {
+        if (!logViewTimer.isActive()) {
+            logViewTimer.start();
+        }
+    }
+}
+
+void MainWindow::updateLogView()
+{
+    logViewTimer.stop();
+    ui->textBrowser_ErrorLog->setPlainText(logger.lines().join("\n"));
+    QScrollBar* bar = ui->textBrowser_ErrorLog->verticalScrollBar();
+    bar->setValue(bar->maximum());
+}
+
+/* Logs one summary of the lines of an episode list that could not be parsed,
+ * instead of a message per line. */
+void MainWindow::logInvalidLines(const EpisodeListParser &parser, SeriesPtr s)
+{
+    if (parser.invalidLines == 0) { return; }
+    log(QString("%1 invalid line(s) in episode list of %2, first: %3")
+        .arg(parser.invalidLines)
+        .arg(s ? s->name : QString("unknown series"))
+        .arg(parser.firstInvalidLine), LogWarning);
+}
+
+/* Returns the name of the local socket of the running instance. It differs per
+ * user, so that each user can run their own instance. */
+QString MainWindow::localServerName()
+{
+    return QString(LOCAL_SERVER_PREFIX "%1").arg(qHash(QDir::homePath()));
+}
+
+/* Starts listening for other instances. Returns false if another instance
+ * is already listening. */
+bool MainWindow::startLocalServer()
+{
+    connect(&localServer, &QLocalServer::newConnection,
+            this, &MainWindow::localConnection);
+
+    localServer.setSocketOptions(QLocalServer::UserAccessOption);
+    QString name = localServerName();
+    if (!localServer.listen(name)) {
+        // Socket may be left over from an instance that did not exit cleanly.
+        // Only remove it if no instance answers on it.
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(500)) {
+            return false;
+        }
+
+        QLocalServer::removeServer(name);
+        if (!localServer.listen(name)) {
+            log("Could not start local server: " + localServer.errorString(),
+                LogError);
+        }
+    }
+    return true;
+}
+
+/* Sends a command to an already running instance and optionally returns its
+ * reply. Returns false if no instance is running. */
+bool MainWindow::sendToRunningInstance(QString command, QString *reply)
+{
+    QLocalSocket socket;
+    socket.connectToServer(localServerName());
+    if (!socket.waitForConnected(500)) {
+        return false;
+    }
+
+    socket.write((command + "\n").toUtf8());
+    socket.waitForBytesWritten(1000);
+
+    // The instance closes the connection after replying
+    QByteArray data;
+    while (socket.waitForReadyRead(2000)) {
+        data += socket.readAll();
+    }
+    data += socket.readAll();
+
+    if (reply) {
+        *reply = QString::fromUtf8(data);
+    }
+    return true;
+}
+
+void MainWindow::localConnection()
+{
+    while (QLocalSocket* socket = localServer.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected,
+                socket, &QObject::deleteLater);
+        QTimer::singleShot(LOCAL_CLIENT_TIMEOUT_MS, socket, [=]() {
+            socket->abort();
+            socket->deleteLater();
+        });
+        connect(socket, &QLocalSocket::readyRead, this, [=]() {
+            // One command line per connection
+            if (!socket->canReadLine()) { return; }
+            QString command = QString::fromUtf8(socket->readLine()).trimmed();
+            socket->write(handleLocalCommand(command).toUtf8());
+            socket->disconnectFromServer();
+        });
+    }
+}
+
+/* Handles a command received over the local socket and returns the reply.
+ * Commands:
+ *   show [query]     Raise the window and search for query, if specified
+ *   search <query>   List matching series as <id><tab><name> lines */
+QString MainWindow::handleLocalCommand(QString command)
+{
+    QString verb = command.section(' ', 0, 0);
+    QString arg = command.section(' ', 1).trimmed();
+
+    if (verb == "show") {
+        showNormal();
+        raise();
+        activateWindow();
+        if (!arg.isEmpty()) {
+            searchFor(arg);
+        }
+        return "ok\n";
+
+    } else if (verb == "search") {
+        // An empty key would match the whole series list
+        QString key = Series::makeSearchKey(arg);
+        if (key.isEmpty()) {
+            return "error: missing query\n";
+        }
+        QString reply;
+        foreach (SeriesPtr s, seriesList) {
+            if (s->searchKey.contains(key)) {
+                reply += s->id + "\t" + s->name + "\n";
+            }
+        }
+        return reply;
+    }
+
+    return "error: unknown command\n";
+}
+
+/* Shows the main page with the results of searching for query. */
+void MainWindow::searchFor(QString query)
+{
+    ui->stackedWidget->setCurrentWidget(ui->page_main);
+    ui->lineEdit->setText(query);
+    on_getButton_clicked();
 }
 
 /* Returns the settings directory, with the optional specified filename added to
@@ -103,7 +302,7 @@ QString MainWindow::getSettingsDir(QString addfile)
         if (dir.mkpath(settingsDir)) {
             log("Created settings directory: " + settingsDir);
         } else {
-            log("Failed to create settings directory: " + settingsDir);
+            log("Failed to create settings directory: " + settingsDir, LogError);
         }
     }
 
@@ -119,15 +318,71 @@ QString MainWindow::getSeriesCacheFilename(SeriesPtr s)
 void MainWindow::doDownload(const QUrl &url)
 {
     QNetworkRequest request(url);
-    manager.get(request);
+    // Allow HTTP/2 and pipelining so requests can share the (pre)connection
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+
+    QNetworkReply* reply = manager.get(request);
+
+    // Record when the download stages complete for the log
+    downloadTimings[reply].timer.start();
+    connect(reply, &QNetworkReply::encrypted, this, [=]() {
+        DownloadTiming &t = downloadTimings[reply];
+        t.encrypted = t.timer.elapsed();
+    });
+    connect(reply, &QNetworkReply::metaDataChanged, this, [=]() {
+        DownloadTiming &t = downloadTimings[reply];
+        if (t.firstByte < 0) {
+            t.firstByte = t.timer.elapsed();
+        }
+    });
+}
+
+/* Logs how long the stages of a finished download took. Qt does not report
+ * DNS lookup and TCP connect separately, so these are included in the TLS
+ * time. No TLS time is reported if an existing connection was reused. */
+void MainWindow::logDownloadTiming(QNetworkReply *reply)
+{
+    if (!downloadTimings.contains(reply)) { return; }
+    DownloadTiming t = downloadTimings.take(reply);
+    qint64 total = t.timer.elapsed();
+
+    QString msg = "Download of " + reply->request().url().toString() + ":";
+    if (t.encrypted >= 0) {
+        msg += QString(" connect+TLS %1 ms,").arg(t.encrypted);
+    } else {
+        msg += " reused connection,";
+    }
+    if (t.firstByte >= 0) {
+        msg += QString(" first byte %1 ms, transfer %2 ms,")
+                .arg(t.firstByte).arg(total - t.firstByte);
+    }
+    msg += QString(" total %1 ms").arg(total);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+    if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+        msg += " (HTTP/2)";
+    }
+#endif
+    log(msg);
 }
 
 void MainWindow::downloadFinished(QNetworkReply *reply)
 {
+    // Replies to preconnect() carry no data
+    if (reply->url().scheme().startsWith("preconnect")) {
+        reply->deleteLater();
+        return;
+    }
+
+    logDownloadTiming(reply);
+    reply->deleteLater();
+
     if (reply->error()) {
         ui->label->setText("Download failed");
-        log("Download failed of: " + reply->request().url().toString());
-        log("Error: " + reply->errorString());
+        log("Download failed of: " + reply->request().url().toString(), LogError);
+        log("Error: " + reply->errorString(), LogError);
 
     } else {
 
@@ -141,9 +396,11 @@ void MainWindow::downloadFinished(QNetworkReply *reply)
             seriesListGUI.clear();
             ui->listWidget->clear();
 
-            while (!reply->atEnd()) {
-                addLineToSeriesList(reply->readLine());
-            }
+            parseSeriesList(reply->readAll());
+            resolveFavourites();
+            buildCacheIndexes();
+            // Series that left the list may have orphaned episode caches
+            QTimer::singleShot(EPCACHE_CLEANUP_DELAY_MS, this, &MainWindow::cleanUpEpisodeCaches);
 
             // Update user interface
             ui->lineEdit->clear();
@@ -164,17 +421,21 @@ void MainWindow::downloadFinished(QNetworkReply *reply)
             // Clear lists
             clearEpisodeLists();
 
+            EpisodeListParser parser(currentSeries);
             while (!reply->atEnd()) {
                 line = reply->readLine();
-                addLineToEpisodeList(line);
+                addLineToEpisodeList(parser, line);
             }
+            logInvalidLines(parser, currentSeries);
+            addEpListToGUI();
 
             if (currentSeries) {
                 ui->label->setText(currentSeries->name);
             }
 
-            // Save episode list to cache file
+            // Save episode list to cache file and keep it in memory
             saveEpCacheFile();
+            cacheEpList(currentSeries, QDate::currentDate());
 
         }
     }
@@ -185,52 +446,422 @@ void MainWindow::downloadFinished(QNetworkReply *reply)
 
 void MainWindow::clearEpisodeLists()
 {
-    ui->listWidget->clear(); // GUI list of episodes
+    ui->treeWidget_episodes->clear(); // GUI list of episodes
     epList.clear();
+    epSeasons.clear();
 }
 
 /* Search button clicked */
 void MainWindow::on_getButton_clicked()
 {
     // Search for string in the list of series
-    ui->listWidget->clear();
-    seriesListGUI.clear();
-
     QString searchText = ui->lineEdit->text().toLower();
-    for (int i=0; i < seriesList.count(); i++) {
-        SeriesPtr s = seriesList[i];
-        if (searchText.isEmpty() || s->name.toLower().contains(searchText)) {
-            ui->listWidget->addItem(s->name);
-            seriesListGUI.append(i);
-        }
-    }
 
     viewMode = VIEWMODE_SERIES;
     ui->label->setText("Series:");
 
-    // If search is empty, add favourites on the top of the list
-    if (ui->lineEdit->text().length()==0) {
-        addFavListToGUI();
+    QList<SeriesPtr> rows;
+    QStringList texts;
+    favouritesOnTop = false;
+
+    if (searchText.startsWith(SEARCH_EPISODES_PREFIX)) {
+
+        searchEpisodes(searchText.mid(QString(SEARCH_EPISODES_PREFIX).count()),
+                       rows, texts);
+
+    } else {
+
+        SeriesQuery query = parseSeriesQuery(searchText);
+
+        if (query.isEmpty()) {
+            // Favourites on the top of the list, with their number of
+            // unwatched episodes, followed by all series
+            foreach (SeriesPtr s, favList) {
+                texts.append(favouriteRowText(s));
+            }
+            rows = favList;
+            rows.append(seriesList);
+            favouritesOnTop = true;
+        } else if (query.hasYearRange()) {
+            // Only search the series in the year range, in list order
+            SeriesRange range = seriesInYearRange(query.yearFrom, query.yearTo);
+            for (SeriesRange::first_type it = range.first; it != range.second; ++it) {
+                if (matchesQuery(*it, query)) {
+                    rows.append(*it);
+                }
+            }
+            std::sort(rows.begin(), rows.end(),
+                      [](const SeriesPtr &a, const SeriesPtr &b) {
+                return a->index < b->index;
+            });
+        } else {
+            foreach (SeriesPtr s, seriesList) {
+                if (matchesQuery(s, query)) {
+                    rows.append(s);
+                }
+            }
+        }
+
+        for (int i=texts.count(); i < rows.count(); i++) {
+            texts.append(seriesRowText(rows[i]));
+        }
     }
 
+    showSeriesRows(rows, texts);
+
     // If only one series is in the list, go directly to it.
     if (ui->listWidget->count() == 1) {
         loadEpList(0);
+    } else {
+        updateGUI();
     }
 }
 
-void MainWindow::addFavListToGUI()
+/* Returns the text of a series row: its name, followed by a badge if its
+ * episode list is cached and it has a new or upcoming episode. The badge is
+ * worked out from the summary of the cached list, without reading it. */
+QString MainWindow::seriesRowText(SeriesPtr s)
 {
-    for (int i=favList.count()-1; i >= 0; i--) {
-        // Add name to GUI list
-        QListWidgetItem* item = new QListWidgetItem();
-        item->setText(favList[i]->name);
+    if (!summaries.contains(s->id)) { return s->name; }
+
+    SeriesSummary summary = summaries.value(s->id);
+    QDate today = QDate::currentDate();
+
+    if (summary.nextAiring.isValid()) {
+        qint64 days = today.daysTo(summary.nextAiring);
+        if (days > 1) {
+            return QString("%1   [next: %2 days]").arg(s->name).arg(days);
+        } else if (days == 1) {
+            return s->name + "   [next: tomorrow]";
+        } else if (days == 0) {
+            return s->name + "   [next: today]";
+        } else if (-days <= SERIES_NEW_DAYS) {
+            // Aired recently, since the list was cached
+            return s->name + "   [new]";
+        }
+        // Aired too long ago to be new. Episodes aired before it are older.
+        return s->name;
+    }
+    if (summary.lastAired.isValid()
+            && (summary.lastAired.daysTo(today) <= SERIES_NEW_DAYS)) {
+        return s->name + "   [new]";
+    }
+    return s->name;
+}
+
+/* Returns the text of a favourite row at the top of the list: the row text of
+ * the series with its number of unwatched episodes. */
+QString MainWindow::favouriteRowText(SeriesPtr s)
+{
+    QString text = seriesRowText(s);
+    int unwatched = watched.unwatchedCount(s->id);
+    if (unwatched > 0) {
+        text += QString("   (%1 unwatched)").arg(unwatched);
+    }
+    return text;
+}
+
+/* Splits the search text into the text to search for and filters:
+ *   year:2015..2020, year:2015.., year:..2020 or year:2015
+ *   status:running or status:ended
+ * The filter controls override the filters in the text. */
+SeriesQuery MainWindow::parseSeriesQuery(QString searchText)
+{
+    SeriesQuery query;
+
+    QStringList words;
+    foreach (QString word, searchText.split(' ')) {
+        if (word.startsWith("year:")) {
+            QString range = word.mid(5);
+            if (range.contains("..")) {
+                query.yearFrom = range.section("..", 0, 0).toInt();
+                query.yearTo = range.section("..", 1).toInt();
+            } else {
+                query.yearFrom = range.toInt();
+                query.yearTo = query.yearFrom;
+            }
+        } else if (word.startsWith("status:")) {
+            // Other values are ignored
+            QString status = word.mid(7);
+            if ((status == "running") || (status == "ended")) {
+                query.status = status;
+            }
+        } else if (!word.isEmpty()) {
+            words.append(word);
+        }
+    }
+    query.text = Series::makeSearchKey(words.join(" "));
+
+    if (ui->spinBox_yearFrom->value() > 0) {
+        query.yearFrom = ui->spinBox_yearFrom->value();
+    }
+    if (ui->spinBox_yearTo->value() > 0) {
+        query.yearTo = ui->spinBox_yearTo->value();
+    }
+    if (ui->comboBox_status->currentIndex() == 1) {
+        query.status = "running";
+    } else if (ui->comboBox_status->currentIndex() == 2) {
+        query.status = "ended";
+    }
+
+    return query;
+}
+
+/* Returns whether the series matches the text and status of the query. The
+ * year range is handled by seriesInYearRange(). */
+bool MainWindow::matchesQuery(const SeriesPtr &s, const SeriesQuery &query)
+{
+    if (!query.status.isEmpty() && ((query.status == "ended") != s->ended())) {
+        return false;
+    }
+    // Both are folded, so a plain case-sensitive search suffices
+    return query.text.isEmpty() || s->searchKey.contains(query.text);
+}
+
+/* Returns the range of seriesByYear with the series that started in the years
+ * from to to, inclusive, found by binary search. A year of 0 leaves that end
+ * unbounded. The range is only valid until seriesByYear changes. */
+SeriesRange MainWindow::seriesInYearRange(int from, int to)
+{
+    if (from <= 0) { from = 1; }
+    if (to <= 0) { to = INT_MAX; }
+    if (from > to) {
+        return SeriesRange(seriesByYear.constEnd(), seriesByYear.constEnd());
+    }
+
+    QVector<SeriesPtr>::const_iterator first = std::lower_bound(
+                seriesByYear.constBegin(), seriesByYear.constEnd(), from,
+                [](const SeriesPtr &s, int year) { return s->year < year; });
+    QVector<SeriesPtr>::const_iterator last = std::upper_bound(
+                first, seriesByYear.constEnd(), to,
+                [](int year, const SeriesPtr &s) { return year < s->year; });
+
+    return SeriesRange(first, last);
+}
+
+void MainWindow::on_spinBox_yearFrom_editingFinished()
+{
+    if (viewMode == VIEWMODE_SERIES) { on_getButton_clicked(); }
+}
+
+void MainWindow::on_spinBox_yearTo_editingFinished()
+{
+    if (viewMode == VIEWMODE_SERIES) { on_getButton_clicked(); }
+}
+
+void MainWindow::on_comboBox_status_activated(int /*index*/)
+{
+    if (viewMode == VIEWMODE_SERIES) { on_getButton_clicked(); }
+}
+
+/* Shows the series in the GUI list with the specified row texts, and keeps
+ * them in the parallel seriesListGUI. All rows are added in one go, after
+ * which favourite series are colourised. */
+void MainWindow::showSeriesRows(const QList<SeriesPtr> &rows, const QStringList &texts)
+{
+    ui->listWidget->clear();
+    ui->listWidget->addItems(texts);
+    seriesListGUI = rows;
+
+    if (favIds.isEmpty()) { return; }
+    for (int i=0; i < rows.count(); i++) {
+        if (isFavourite(rows[i])) {
+            colourSeriesRow(i);
+        }
+    }
+}
+
+/* Colourises the row if its series is a favourite, with the next unwatched
+ * episode as tooltip, and resets it to the default otherwise. */
+void MainWindow::colourSeriesRow(int row)
+{
+    QListWidgetItem* item = ui->listWidget->item(row);
+    SeriesPtr s = seriesListGUI.value(row);
+    if (!item) { return; }
+
+    if (isFavourite(s)) {
         item->setBackground(favBgColor);
         item->setForeground(favFgColor);
-        ui->listWidget->insertItem(0, item);
-        // Add series index to parallel list
-        seriesListGUI.prepend(-1);
+        int next = watched.nextUnwatched(s->id);
+        item->setToolTip((next > 0) ? QString("Next unwatched: episode %1").arg(next)
+                                    : QString());
+    } else {
+        item->setBackground(QBrush());
+        item->setForeground(QBrush());
+        item->setToolTip(QString());
+    }
+}
+
+/* Toggles the favourite state of the series and updates the series view in
+ * place: its row among the favourites on top is added or removed, and its
+ * other rows are coloured accordingly. */
+void MainWindow::toggleFavouriteRows(SeriesPtr s)
+{
+    if (isFavourite(s)) {
+        int favRow = -1;
+        for (int i=0; i < favList.count(); i++) {
+            if (favList[i]->id == s->id) {
+                favRow = i;
+                break;
+            }
+        }
+        removeFavourite(s);
+        if (favouritesOnTop && (favRow >= 0)) {
+            delete ui->listWidget->takeItem(favRow);
+            seriesListGUI.removeAt(favRow);
+        }
+    } else {
+        addFavourite(s);
+        if (favouritesOnTop) {
+            int favRow = favList.count() - 1;
+            ui->listWidget->insertItem(favRow, favouriteRowText(s));
+            seriesListGUI.insert(favRow, s);
+        }
+    }
+
+    bool selected = !ui->listWidget->selectedItems().isEmpty();
+    for (int i=0; i < seriesListGUI.count(); i++) {
+        if (seriesListGUI[i] != s) { continue; }
+        colourSeriesRow(i);
+        // Keep the series selected if its removed row was
+        if (!selected) {
+            ui->listWidget->setCurrentRow(i);
+            selected = true;
+        }
+    }
+}
+
+/* Searches episode titles of all cached series and returns the matching
+ * episodes as rows. Each row refers to the series of the episode. */
+void MainWindow::searchEpisodes(QString query, QList<SeriesPtr> &rows, QStringList &texts)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<EpisodeIndexHit> hits = epIndex.search(query);
+    foreach (EpisodeIndexHit hit, hits) {
+        SeriesPtr s = seriesNumberMap.value(hit.seriesId);
+        if (!s) { continue; }
+
+        rows.append(s);
+        texts.append(QString("%1   %2   %3")
+                     .arg(s->name).arg(hit.number).arg(hit.title));
+    }
+
+    ui->label->setText("Episodes:");
+    ui->notifyLabel->setText(QString("%1 episodes found in %2 ms")
+                             .arg(rows.count()).arg(timer.elapsed()));
+}
+
+bool MainWindow::isFavourite(SeriesPtr s)
+{
+    return s && favIds.contains(s->id);
+}
+
+void MainWindow::addFavourite(SeriesPtr s)
+{
+    if (!s || isFavourite(s)) { return; }
+    favList.append(s);
+    favIds.insert(s->id);
+    favRevision++;
+}
+
+void MainWindow::removeFavourite(SeriesPtr s)
+{
+    if (!isFavourite(s)) { return; }
+    favIds.remove(s->id);
+    favRevision++;
+    for (int i=0; i < favList.count(); i++) {
+        if (favList[i]->id == s->id) {
+            favList.removeAt(i);
+            break;
+        }
+    }
+}
+
+/* Keeps the state of the series view, so that it can be restored without
+ * searching again when going back from the episodes. */
+void MainWindow::saveSeriesViewState()
+{
+    seriesViewState.valid = true;
+    seriesViewState.searchText = ui->lineEdit->text();
+    seriesViewState.label = ui->label->text();
+    seriesViewState.scrollPos = ui->listWidget->verticalScrollBar()->value();
+    seriesViewState.favouritesOnTop = favouritesOnTop;
+    seriesViewState.favRevision = favRevision;
+    seriesViewState.watchedRevision = watched.revision();
+    seriesViewState.summaryRevision = summaries.revision();
+}
+
+void MainWindow::restoreSeriesView()
+{
+    SeriesViewState &state = seriesViewState;
+    ui->lineEdit->setText(state.searchText);
+
+    if (state.favouritesOnTop && (state.favRevision != favRevision)) {
+        // Favourites at the top of the list changed, so it has to be rebuilt
+        on_getButton_clicked();
+        // Lay out items first so the scroll range is up to date
+        ui->listWidget->doItemsLayout();
+        ui->listWidget->verticalScrollBar()->setValue(state.scrollPos);
+    } else {
+        // The series list was left untouched while viewing the episodes
+        viewMode = VIEWMODE_SERIES;
+        ui->label->setText(state.label);
+        favouritesOnTop = state.favouritesOnTop;
+
+        // Only the badge, unwatched count and favourite state of the series
+        // just viewed can have changed. Without a query, the favourites are
+        // also on top of the list with their unwatched count.
+        bool watchedChanged = (state.watchedRevision != watched.revision());
+        bool textChanged = (state.summaryRevision != summaries.revision())
+                || (state.favouritesOnTop && watchedChanged);
+        bool colourChanged = (state.favRevision != favRevision) || watchedChanged;
+        if (state.searchText.toLower().startsWith(SEARCH_EPISODES_PREFIX)) {
+            // Episode rows have no badges
+            textChanged = false;
+        }
+        int favRows = state.favouritesOnTop ? favList.count() : 0;
+
+        if (currentSeries && (textChanged || colourChanged)) {
+            for (int i=0; i < seriesListGUI.count(); i++) {
+                if (seriesListGUI[i] != currentSeries) { continue; }
+                if (textChanged) {
+                    ui->listWidget->item(i)->setText(
+                                (i < favRows) ? favouriteRowText(currentSeries)
+                                              : seriesRowText(currentSeries));
+                }
+                if (colourChanged) {
+                    colourSeriesRow(i);
+                }
+            }
+        }
     }
+
+    state.valid = false;
+    updateGUI();
+}
+
+/* Favourites are loaded from file before the series list is available. Once
+ * it is, replace them with the matching series list instances so that both
+ * refer to the same objects. */
+void MainWindow::resolveFavourites()
+{
+    for (int i=0; i < favList.count(); i++) {
+        SeriesPtr s = seriesNumberMap.value(favList[i]->id);
+        if (s) {
+            favList[i] = s;
+        }
+    }
+}
+
+/* Returns the series of the selected row in the series view, or null if
+ * nothing is selected. */
+SeriesPtr MainWindow::selectedSeries()
+{
+    QList<QListWidgetItem*> items = ui->listWidget->selectedItems();
+    if (items.isEmpty()) { return SeriesPtr(); }
+    return seriesListGUI.value(ui->listWidget->row(items.first()));
 }
 
 void MainWindow::on_lineEdit_returnPressed()
@@ -240,29 +871,39 @@ void MainWindow::on_lineEdit_returnPressed()
 
 void MainWindow::loadEpList(int index)
 {
-    // Use index to get a series in seriesListGUI, then use that index to get
-    // the series from the main seriesList.
-    // If the entry in seriesListGUI is negative, it is a favourite.
-    if (seriesListGUI[index] >= 0) {
-        loadEpList(seriesList[seriesListGUI[index]]);
-        currentEpIsFavourite = 0;
-    } else {
-        // Negative: load from favourite list
-        loadEpList(favList[index]);
-        currentEpIsFavourite = 1;
+    // Use index to get the series displayed in that row of the GUI list
+    SeriesPtr s = seriesListGUI.value(index);
+    if (s) {
+        loadEpList(s);
     }
     updateGUI();
 }
 
 void MainWindow::loadEpList(SeriesPtr s, bool redownload)
 {
+    if (viewMode == VIEWMODE_SERIES) {
+        saveSeriesViewState();
+    }
+
     currentSeries = s;
     viewMode = VIEWMODE_EPISODES;
 
     clearEpisodeLists();
 
-    // Try to load from cache file first
-    if (loadEpListFile(s) && !redownload) {
+    // Try recently viewed lists in memory first, then the cache file
+    if (!redownload && loadEpListFromMemory(s)) {
+
+        epCaches.touch(getSeriesCacheFilename(s));
+        QString lbl = "Episode list loaded from memory";
+        addDaysOldString(lbl, currentListAge);
+
+        ui->notifyLabel->setText(lbl);
+        ui->label->setText(s->name);
+
+    } else if (loadEpListFile(s) && !redownload) {
+
+        epCaches.touch(getSeriesCacheFilename(s));
+        cacheEpList(s, epListFileInfo.lastModified().date());
 
         // Get how old file is in days
         currentListAge = calculateDaysOld(epListFileInfo);
@@ -277,15 +918,16 @@ void MainWindow::loadEpList(SeriesPtr s, bool redownload)
 
         QString address;
         if (!s->mazeNo.isEmpty()) {
-            address = QString("https://epguides.com/common/exportToCSVmaze.asp?maze=%1")
+            address = QString(EPGUIDES_URL "/common/exportToCSVmaze.asp?maze=%1")
                     .arg(s->mazeNo);
         } else if (!s->rageNo.isEmpty()) {
-            address = QString("https://epguides.com/common/exportToCSV.asp?rage=%1")
+            address = QString(EPGUIDES_URL "/common/exportToCSV.asp?rage=%1")
                     .arg(s->rageNo);
         }
 
         if (address.isEmpty()) {
-            log("loadEpList: Series maze and rage numbers empty; " + currentSeries->rawText);
+            log("loadEpList: Series maze and rage numbers empty; " + currentSeries->rawText,
+                LogWarning);
             ui->label->setText("Series has no maze or rage number.");
         } else {
 
@@ -302,17 +944,19 @@ void MainWindow::on_listWidget_doubleClicked(QModelIndex index)
 {
     if (viewMode == VIEWMODE_SERIES) {
         loadEpList(index.row());
-    } else if (viewMode == VIEWMODE_EPISODES) {
-
-        // Copy episode name to clipboard
+    }
+}
 
-        EpisodePtr ep = epList.value(index.row());
-        if (ep) {
-            QString text = QString("%1 %2 - %3")
-                    .arg(ep->series->name).arg(ep->number).arg(ep->name);
-            QApplication::clipboard()->setText(text);
-            ui->notifyLabel->setText("'" + text + "' copied to clipboard.");
-        }
+void MainWindow::on_treeWidget_episodes_itemDoubleClicked(QTreeWidgetItem* item, int /*column*/)
+{
+    // Copy episode name to clipboard
+
+    EpisodePtr ep = episodeFromItem(item);
+    if (ep) {
+        QString text = QString("%1 %2 - %3")
+                .arg(ep->series->name).arg(ep->number).arg(ep->name);
+        QApplication::clipboard()->setText(text);
+        ui->notifyLabel->setText("'" + text + "' copied to clipboard.");
     }
 }
 
@@ -325,16 +969,81 @@ bool MainWindow::loadSeriesListFile()
         return false; // Failed to open file
     }
 
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        addLineToSeriesList(line);
-    }
+    parseSeriesList(file.readAll());
 
     seriesListInfo = QFileInfo(file);
     return true;
 }
 
+/* Parses the lines from begin up to end in data and returns the valid series.
+ * Runs in a worker thread, so names are not HTML decoded here. */
+static QList<SeriesPtr> parseSeriesChunk(const QByteArray *data, int begin, int end)
+{
+    QList<SeriesPtr> list;
+    while (begin < end) {
+        int lineEnd = data->indexOf('\n', begin);
+        if ((lineEnd < 0) || (lineEnd > end)) { lineEnd = end; }
+        int len = lineEnd - begin;
+        if ((len > 0) && (data->at(begin + len - 1) == '\r')) { len--; }
+
+        SeriesPtr s(new Series(QString::fromUtf8(data->constData() + begin, len), false));
+        if (s->valid) {
+            list.append(s);
+        }
+        begin = lineEnd + 1;
+    }
+    return list;
+}
+
+/* Parses the series list text and adds the series to seriesList. The data is
+ * split at line boundaries into one chunk per thread which are parsed in
+ * parallel, then merged in file order. */
+void MainWindow::parseSeriesList(const QByteArray &data)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int threads = parseThreads;
+    if (threads <= 0) {
+        threads = QThread::idealThreadCount();
+    }
+    threads = qMax(1, threads);
+    parsePool.setMaxThreadCount(threads);
+
+    QList< QFuture< QList<SeriesPtr> > > chunks;
+    int chunkSize = data.size() / threads + 1;
+    int begin = 0;
+    while (begin < data.size()) {
+        int end = begin + chunkSize;
+        if (end >= data.size()) {
+            end = data.size();
+        } else {
+            // Extend chunk to the end of the line
+            end = data.indexOf('\n', end);
+            end = (end < 0) ? data.size() : end + 1;
+        }
+        chunks.append(QtConcurrent::run(&parsePool, parseSeriesChunk, &data, begin, end));
+        begin = end;
+    }
+
+    // Merge in file order so the first of duplicate series still wins
+    foreach (QFuture< QList<SeriesPtr> > chunk, chunks) {
+        foreach (SeriesPtr s, chunk.result()) {
+            addToSeriesList(s);
+        }
+    }
+
+    // Index for year range searches
+    seriesByYear = seriesList.toVector();
+    std::stable_sort(seriesByYear.begin(), seriesByYear.end(),
+                     [](const SeriesPtr &a, const SeriesPtr &b) {
+        return a->year < b->year;
+    });
+
+    log(QString("Parsed %1 series in %2 ms using %3 thread(s)")
+        .arg(seriesList.count()).arg(timer.elapsed()).arg(threads));
+}
+
 // Loads favourites list from file, and if it fails returns false.
 bool MainWindow::loadFavListFile()
 {
@@ -349,13 +1058,38 @@ bool MainWindow::loadFavListFile()
         QString line = in.readLine();
         SeriesPtr s(new Series(line));
         if (s->valid) {
-            favList.append(s);
+            addFavourite(s);
         }
     }
 
     return true;
 }
 
+/* Shows the episode list of the series if it is in the in-memory cache, and
+ * returns false if it isn't. */
+bool MainWindow::loadEpListFromMemory(SeriesPtr s)
+{
+    CachedEpList* cached = epListCache.object(s->id);
+    if (!cached) { return false; }
+
+    epList = cached->episodes;
+    addEpListToGUI();
+    currentListAge = cached->date.daysTo(QDate::currentDate());
+    return true;
+}
+
+/* Keeps the current episode list of the series in the in-memory cache. The
+ * least recently used lists are dropped once the total number of episodes
+ * exceeds EPLIST_CACHE_MAX_EPISODES. */
+void MainWindow::cacheEpList(SeriesPtr s, QDate date)
+{
+    if (!s) { return; }
+    CachedEpList* cached = new CachedEpList();
+    cached->episodes = epList;
+    cached->date = date;
+    epListCache.insert(s->id, cached, qMax(1, epList.count()));
+}
+
 // Loads cached episode list from file, returns false if file doesn't exist
 bool MainWindow::loadEpListFile(SeriesPtr s)
 {
@@ -366,58 +1100,161 @@ bool MainWindow::loadEpListFile(SeriesPtr s)
         return false;
     }
 
+    EpisodeListParser parser(s);
     QTextStream in(&file);
     while (!in.atEnd()) {
         QString line = in.readLine();
-        addLineToEpisodeList(line);
+        addLineToEpisodeList(parser, line);
     }
+    logInvalidLines(parser, s);
+    addEpListToGUI();
 
     epListFileInfo = QFileInfo(file);
     return true;
 }
 
-/* Adds a line that is read from the series list text file to the seriesList
- * if valid. */
-void MainWindow::addLineToSeriesList(QString line)
+/* Adds a parsed series to the seriesList, unless a series with the same
+ * number was already added. Must be called from the GUI thread. */
+void MainWindow::addToSeriesList(SeriesPtr s)
 {
-    SeriesPtr s(new Series(line));
-    if (s->valid) {
-        QString no = QString("%1_%2").arg(s->mazeNo).arg(s->rageNo);
-        if (!seriesNumberMap.contains(no)) {
-            seriesList.append(s);
-            seriesNumberMap.insert(no, s);
-        } else {
-            //log("Debug: duplicate series: " + s->name);
+    if (!seriesNumberMap.contains(s->id)) {
+        QString name = Series::decodeHtml(s->name);
+        if (name != s->name) {
+            s->name = name;
+            s->searchKey = Series::makeSearchKey(name);
         }
+        s->index = seriesList.count();
+        seriesList.append(s);
+        seriesNumberMap.insert(s->id, s);
+    } else {
+        //log("Debug: duplicate series: " + s->name);
     }
 }
 
-// Parse an episode line and add to the appropriate lists
-void MainWindow::addLineToEpisodeList(QString line)
+/* Parse an episode line and add it to the top of epList. The GUI list is
+ * filled afterwards by addEpListToGUI(). Invalid lines are counted by the
+ * parser and logged afterwards by logInvalidLines(). */
+void MainWindow::addLineToEpisodeList(EpisodeListParser &parser, QString line)
 {
-    EpisodePtr ep(new Episode(line, currentSeries));
+    EpisodePtr ep = parser.parseLine(line);
+    if (!ep) { return; }
 
-    if (!ep->valid) {
-        log("Episode line not valid: " + ep->rawText);
-        return;
+    // Insert entry at top of list
+    epList.prepend(ep);
+}
+
+/* Shows epList in the GUI grouped by season, newest first, with specials at
+ * the end. Only the season rows are created here; the episode rows of a
+ * season are created when it is expanded. The newest season is expanded. */
+void MainWindow::addEpListToGUI()
+{
+    // Keep the number of aired episodes up to date for the unwatched count
+    QDate today = QDate::currentDate();
+    currentAiredOrdinal = 0;
+    foreach (EpisodePtr ep, epList) {
+        if (ep->date.isValid() && (ep->date <= today)) {
+            currentAiredOrdinal = qMax(currentAiredOrdinal, ep->ordinal);
+        }
+    }
+    if (currentSeries) {
+        watched.setAired(currentSeries->id, currentAiredOrdinal);
     }
 
-    // Insert entry at top of list
-    ui->listWidget->insertItem(0, QString("%1   %2")
-                               .arg(ep->number).arg(ep->name));
+    // Group by season, in epList order. Specials have season -1.
+    epSeasons.clear();
+    QHash<int, int> seasonIndex;
+    foreach (EpisodePtr ep, epList) {
+        int season = ep->special ? -1 : ep->seasonNo;
+        if (!seasonIndex.contains(season)) {
+            seasonIndex.insert(season, epSeasons.count());
+            epSeasons.append(QList<EpisodePtr>());
+        }
+        epSeasons[seasonIndex.value(season)].append(ep);
+    }
+    if (seasonIndex.contains(-1)) {
+        epSeasons.move(seasonIndex.value(-1), epSeasons.count() - 1);
+    }
+
+    QList<QTreeWidgetItem*> items;
+    for (int i=0; i < epSeasons.count(); i++) {
+        const QList<EpisodePtr> &episodes = epSeasons.at(i);
+        int aired = 0;
+        foreach (EpisodePtr ep, episodes) {
+            if (ep->date.isValid() && (ep->date <= today)) { aired++; }
+        }
+
+        QString title = episodes.first()->special
+                ? QString("Specials")
+                : QString("Season %1").arg(episodes.first()->seasonNo);
+        QTreeWidgetItem* item = new QTreeWidgetItem(QStringList()
+                << QString("%1   (%2 aired, %3 unaired)")
+                   .arg(title).arg(aired).arg(episodes.count() - aired));
+        item->setData(0, Qt::UserRole, i);
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        items.append(item);
+    }
+    ui->treeWidget_episodes->addTopLevelItems(items);
+
+    if (!items.isEmpty()) {
+        items.first()->setExpanded(true);
+    }
+}
+
+/* Creates the episode rows of a season when it is expanded the first time */
+void MainWindow::episodeSeasonExpanded(QTreeWidgetItem* item)
+{
+    if (item->parent() || item->childCount()) { return; }
+
+    QList<EpisodePtr> episodes = epSeasons.value(item->data(0, Qt::UserRole).toInt());
+    QList<QTreeWidgetItem*> children;
+    for (int i=0; i < episodes.count(); i++) {
+        QTreeWidgetItem* child = createEpisodeItem(episodes[i]);
+        child->setData(0, Qt::UserRole, i);
+        children.append(child);
+    }
+    item->addChildren(children);
+}
+
+/* Returns the episode of an episode row, or null for season rows. */
+EpisodePtr MainWindow::episodeFromItem(QTreeWidgetItem* item)
+{
+    if (!item || !item->parent()) { return EpisodePtr(); }
+    int season = item->parent()->data(0, Qt::UserRole).toInt();
+    return epSeasons.value(season).value(item->data(0, Qt::UserRole).toInt());
+}
+
+/* Episode checked or unchecked as watched */
+void MainWindow::episodeItemChanged(QTreeWidgetItem* item, int /*column*/)
+{
+    EpisodePtr ep = episodeFromItem(item);
+    if (!ep || (ep->ordinal <= 0)) { return; }
+
+    watched.setWatched(ep->series->id, ep->ordinal,
+                       item->checkState(0) == Qt::Checked);
+    watched.setAired(ep->series->id, currentAiredOrdinal);
+}
+
+QTreeWidgetItem* MainWindow::createEpisodeItem(EpisodePtr ep)
+{
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList()
+            << QString("%1   %2").arg(ep->number).arg(ep->name));
+    if (ep->ordinal > 0) {
+        // Checkbox to mark as watched
+        item->setCheckState(0, watched.isWatched(ep->series->id, ep->ordinal)
+                            ? Qt::Checked : Qt::Unchecked);
+    }
     if (ep->date.isValid()) {
         // Date tooltip
-        ui->listWidget->item(0)->setToolTip(ep->date.toString());
+        item->setToolTip(0, ep->date.toString());
 
         // Check if episode is released yet and grey out background if not
 
         if (ep->date.operator >(QDate::currentDate())) {
-            ui->listWidget->item(0)->setBackground(unreleasedBgColor);
-            ui->listWidget->item(0)->setForeground(unreleasedFgColor);
+            item->setBackground(0, unreleasedBgColor);
+            item->setForeground(0, unreleasedFgColor);
         }
     }
-
-    epList.prepend(ep);
+    return item;
 }
 
 void MainWindow::saveSeriesFile()
@@ -430,7 +1267,7 @@ void MainWindow::saveSeriesFile()
 
     QTextStream out(&file);
     foreach (SeriesPtr s, seriesList) {
-        out << s->rawText;
+        out << s->rawText << "\n";
     }
 
     ui->label->setText("Saved list to disk");
@@ -453,6 +1290,187 @@ void MainWindow::saveEpCacheFile()
 
     ui->notifyLabel->setText("Saved list to cache file");
     file.close();
+
+    updateEpisodeIndex();
+    summaries.set(currentSeries->id, summariseEpisodes(epList, QDate::currentDate()));
+
+    epCaches.setFile(filename, file.size());
+    if (epCachesLoaded) {
+        evictEpisodeCaches();
+    }
+}
+
+/* Builds the episode index and episode list summaries from all existing
+ * episode cache files. This is only needed when there are no index and
+ * summary files yet, after which they are kept up to date whenever an episode
+ * list is saved to cache. */
+void MainWindow::buildCacheIndexes()
+{
+    if (epIndexLoaded && summariesLoaded) { return; }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QDir dir(getSettingsDir());
+    QStringList filenames = dir.entryList(QStringList() << "epscache_*.txt", QDir::Files);
+    foreach (QString filename, filenames) {
+        // Filename is epscache_<maze>_<rage>_<directory>.txt
+        QStringList parts = filename.split("_");
+        SeriesPtr s = seriesNumberMap.value(parts.value(1) + "_" + parts.value(2));
+        if (!s) { continue; }
+
+        QFile file(dir.filePath(filename));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { continue; }
+
+        QList<EpisodePtr> episodes;
+        EpisodeListParser parser(s);
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            EpisodePtr ep = parser.parseLine(in.readLine());
+            if (ep) {
+                episodes.append(ep);
+            }
+        }
+
+        if (!epIndexLoaded) {
+            QList<EpisodeIndex::Episode> indexed;
+            foreach (EpisodePtr ep, episodes) {
+                indexed.append(EpisodeIndex::Episode(ep->number, ep->name));
+            }
+            epIndex.setSeriesEpisodes(s->id, indexed);
+        }
+        if (!summariesLoaded) {
+            summaries.set(s->id, summariseEpisodes(
+                              episodes, QFileInfo(file).lastModified().date()));
+        }
+    }
+
+    if (!epIndexLoaded) {
+        epIndex.save();
+        epIndexLoaded = true;
+    }
+    if (!summariesLoaded) {
+        summaries.save();
+        summariesLoaded = true;
+    }
+    log(QString("Built episode index and summaries of %1 cached series in %2 ms")
+        .arg(filenames.count()).arg(timer.elapsed()));
+}
+
+/* Starts the cleanup of episode cache files, once the series list is
+ * available. If the caches are not known yet, the settings directory is first
+ * scanned for them in the background. */
+void MainWindow::cleanUpEpisodeCaches()
+{
+    if (seriesNumberMap.isEmpty()) { return; }
+
+    if (epCachesLoaded) {
+        evictEpisodeCaches();
+    } else if (!epCacheScanWatcher.isRunning()) {
+        epCacheScanWatcher.setFuture(
+                    QtConcurrent::run(&EpisodeCacheStore::scan, getSettingsDir()));
+    }
+}
+
+void MainWindow::epCacheScanFinished()
+{
+    epCaches.merge(epCacheScanWatcher.result());
+    epCachesLoaded = true;
+    evictEpisodeCaches();
+}
+
+/* Removes episode cache files of series no longer in the series list, and then
+ * the least recently used ones until their total size is within the budget.
+ * Caches of favourites and of the current series are always kept. The files
+ * are removed in the background, leaving any written again meanwhile. */
+void MainWindow::evictEpisodeCaches()
+{
+    if (seriesNumberMap.isEmpty()) { return; }
+
+    QStringList evicted;
+    int orphans = 0;
+    qint64 total = 0;
+    QList< QPair<QDateTime, QString> > candidates;
+
+    QHash<QString, EpisodeCacheStore::Entry> entries = epCaches.entries();
+    QHash<QString, EpisodeCacheStore::Entry>::const_iterator it;
+    for (it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QString id = EpisodeCacheStore::seriesId(it.key());
+        if (favIds.contains(id) || (currentSeries && (currentSeries->id == id))) {
+            total += it->size;
+            continue;
+        }
+        if (!seriesNumberMap.contains(id)) {
+            evicted.append(it.key());
+            orphans++;
+            continue;
+        }
+        total += it->size;
+        candidates.append(qMakePair(it->lastUsed, it.key()));
+    }
+
+    qint64 budget = qint64(epCacheBudgetMB) * 1024 * 1024;
+    if ((budget > 0) && (total > budget)) {
+        // Oldest first
+        std::sort(candidates.begin(), candidates.end());
+        for (int i=0; (i < candidates.count()) && (total > budget); i++) {
+            evicted.append(candidates[i].second);
+            total -= entries.value(candidates[i].second).size;
+        }
+    }
+
+    if (evicted.isEmpty()) { return; }
+
+    QHash<QString, EpisodeCacheStore::Entry> removed;
+    foreach (QString cacheFile, evicted) {
+        removed.insert(cacheFile, entries.value(cacheFile));
+        epCaches.remove(cacheFile);
+
+        // Leave the index and summary if the series has a newer cache file
+        QString id = EpisodeCacheStore::seriesId(cacheFile);
+        SeriesPtr s = seriesNumberMap.value(id);
+        if (!s || (getSeriesCacheFilename(s) == cacheFile)) {
+            summaries.remove(id);
+            epIndex.removeSeries(id);
+        }
+    }
+    QtConcurrent::run(&EpisodeCacheStore::removeFiles, getSettingsDir(), removed);
+
+    log(QString("Removed %1 episode cache files (%2 of series no longer listed), "
+                "%3 KB left")
+        .arg(evicted.count()).arg(orphans).arg(total / 1024));
+}
+
+/* Returns the summary of an episode list downloaded on cacheDate. */
+SeriesSummary MainWindow::summariseEpisodes(const QList<EpisodePtr> &episodes,
+                                            QDate cacheDate)
+{
+    SeriesSummary summary;
+    summary.episodeCount = episodes.count();
+    summary.cacheDate = cacheDate;
+    foreach (EpisodePtr ep, episodes) {
+        if (!ep->date.isValid()) { continue; }
+        if (ep->date <= cacheDate) {
+            if (!summary.lastAired.isValid() || (ep->date > summary.lastAired)) {
+                summary.lastAired = ep->date;
+            }
+        } else if (!summary.nextAiring.isValid() || (ep->date < summary.nextAiring)) {
+            summary.nextAiring = ep->date;
+        }
+    }
+    return summary;
+}
+
+/* Updates the episode index with the episodes of the current series, called
+ * whenever its episode cache file is written. The index saves the change
+ * shortly after. */
+void MainWindow::updateEpisodeIndex()
+{
+    QList<EpisodeIndex::Episode> episodes;
+    for (int i=epList.count() - 1; i >= 0; i--) {
+        episodes.append(EpisodeIndex::Episode(epList[i]->number, epList[i]->name));
+    }
+    epIndex.setSeriesEpisodes(currentSeries->id, episodes);
 }
 
 void MainWindow::saveFavFile()
@@ -465,7 +1483,7 @@ void MainWindow::saveFavFile()
 
     QTextStream out(&file);
     foreach (SeriesPtr s, favList) {
-        out << s->rawText << "\n";
+        out << s->rawText.trimmed() << "\n";
     }
 
     file.close();
@@ -483,6 +1501,10 @@ void MainWindow::saveSettingsFile()
     out << SETTINGS_PROXY_SYSTEM << " " << QVariant(useSystemProxy).toString() << "\n";
     out << SETTINGS_PROXY_ADDRESS << " " << proxyAddress << "\n";
     out << SETTINGS_PROXY_PORT << " " << QString::number(proxyPort) << "\n";
+    out << SETTINGS_PARSE_THREADS << " " << QString::number(parseThreads) << "\n";
+    out << SETTINGS_LOG_TO_FILE << " " << QVariant(logToFile).toString() << "\n";
+    out << SETTINGS_EPCACHE_BUDGET << " " << QString::number(epCacheBudgetMB) << "\n";
+    out << SETTINGS_PRECONNECT << " " << QVariant(usePreconnect).toString() << "\n";
 
     file.close();
     ui->label->setText("Saved settings file.");
@@ -506,6 +1528,14 @@ bool MainWindow::loadSettingsFile()
                 proxyPort = words[1].toInt();
             } else if (words[0] == SETTINGS_PROXY_SYSTEM) {
                 useSystemProxy = QVariant(words[1]).toBool();
+            } else if (words[0] == SETTINGS_PARSE_THREADS) {
+                parseThreads = words[1].toInt();
+            } else if (words[0] == SETTINGS_LOG_TO_FILE) {
+                logToFile = QVariant(words[1]).toBool();
+            } else if (words[0] == SETTINGS_EPCACHE_BUDGET) {
+                epCacheBudgetMB = words[1].toInt();
+            } else if (words[0] == SETTINGS_PRECONNECT) {
+                usePreconnect = QVariant(words[1]).toBool();
             }
         }
     }
@@ -531,29 +1561,19 @@ void MainWindow::toggleStarButton(int bright)
 
 void MainWindow::updateGUI()
 {
+    // Series are listed in the list widget, episodes in the tree
+    bool episodes = (viewMode == VIEWMODE_EPISODES);
+    ui->listWidget->setVisible(!episodes);
+    ui->treeWidget_episodes->setVisible(episodes);
+
     if (viewMode == VIEWMODE_SERIES) {
 
-        currentEpIsFavourite = 0;
         // Update Star Button
-        if (ui->listWidget->selectedItems().count()) {
-
+        SeriesPtr s = selectedSeries();
+        if (s) {
             ui->starButton->setEnabled(1);
-
-            toggleStarButton(0); // Make dim
-
-            // Check if favourite item is selected
-            int i;
-            for (i=0; i<favList.length(); i++) {
-                if (ui->listWidget->count() < favList.length()) { break; }
-                if (ui->listWidget->item(i)->isSelected()) {
-                    if (seriesListGUI[i] < 0) {
-                        // This means a favourite item is selected
-                        toggleStarButton(1); // Make bright
-                        break;
-                    }
-                }
-            }
-
+            // Bright if selected series is a favourite
+            toggleStarButton(isFavourite(s));
         } else {
             ui->starButton->setEnabled(0);
         }
@@ -571,11 +1591,7 @@ void MainWindow::updateGUI()
 
         // Update Star Button
         ui->starButton->setEnabled(true);
-        if (currentEpIsFavourite) {
-            toggleStarButton(1); // make bright
-        } else {
-            toggleStarButton(0); // make dim
-        }
+        toggleStarButton(isFavourite(currentSeries));
 
         // Update refresh button
         QString refreshTooltip = "Re-download series list";
@@ -585,43 +1601,32 @@ void MainWindow::updateGUI()
         // Update back button
         ui->backButton->setToolTip("Back to series list");
     }
+
+    ui->renameButton->setVisible(viewMode == VIEWMODE_EPISODES);
 }
 
 void MainWindow::on_actionRe_download_seriesList_triggered()
 {
     ui->label->setText("Downloading list of all series...");
     dlMode = DLMODE_SERIESLIST;
-    QUrl url = QUrl("https://epguides.com/common/allshows.txt");
+    QUrl url = QUrl(EPGUIDES_URL "/common/allshows.txt");
     doDownload(url);
 }
 
 void MainWindow::on_actionAdd_to_favourites_triggered()
 {
     if (viewMode==VIEWMODE_SERIES) {
-        // Add selected item to favList
-        int i;
-        for (i=0; i < ui->listWidget->count(); i++) {
-            if (ui->listWidget->item(i)->isSelected()) {
-                if (seriesListGUI[i] < 0) {
-                    // This means item is in favourites list
-                    favList.removeAt(i);
-                    on_getButton_clicked(); // refresh listWidget
-                    break;
-                } else {
-                    favList.append(seriesList[seriesListGUI[i]]);
-                    on_getButton_clicked(); // refresh listWidget
-                }
-            }
-        }
+        // Toggle favourite state of selected series
+        SeriesPtr s = selectedSeries();
+        if (!s) { return; }
+        toggleFavouriteRows(s);
+        updateGUI();
 
     } else if (viewMode==VIEWMODE_EPISODES) {
 
-        if (currentEpIsFavourite==0) {
-            // Add currentSeries to favList
-            favList.append(currentSeries);
-            currentEpIsFavourite = 1;
-            updateGUI();
-        }
+        // Add currentSeries to favList
+        addFavourite(currentSeries);
+        updateGUI();
     }
 
     // Save favlist to file
@@ -630,8 +1635,13 @@ void MainWindow::on_actionAdd_to_favourites_triggered()
 
 void MainWindow::on_actionBack_triggered()
 {
-    ui->lineEdit->clear();
-    on_getButton_clicked();
+    if ((viewMode == VIEWMODE_EPISODES) && seriesViewState.valid) {
+        // Back to the series view as it was
+        restoreSeriesView();
+    } else {
+        ui->lineEdit->clear();
+        on_getButton_clicked();
+    }
 }
 
 void MainWindow::on_actionClear_Search_triggered()
@@ -669,9 +1679,17 @@ void MainWindow::on_pushButton_SettingsOK_clicked()
     useSystemProxy = ui->checkBox_proxySystem->isChecked();
     proxyAddress = ui->lineEdit_ProxyAddress->text();
     proxyPort = ui->lineEdit_ProxyPort->text().toInt();
+    parseThreads = ui->spinBox_parseThreads->value();
+    logToFile = ui->checkBox_logToFile->isChecked();
+    epCacheBudgetMB = ui->spinBox_epCacheBudget->value();
 
     saveSettingsFile();
 
+    logger.setFile(logToFile ? getSettingsDir(LOG_FILENAME) : QString());
+    if (epCachesLoaded) {
+        evictEpisodeCaches();
+    }
+
     setProxy();
 
     ui->stackedWidget->setCurrentWidget(ui->page_main);
@@ -698,6 +1716,28 @@ void MainWindow::setProxy()
     }
 
     manager.setProxy(proxy);
+
+    if (usePreconnect) {
+        preconnect();
+    }
+}
+
+/* Opens a connection to epguides ahead of the first download, so that it
+ * doesn't wait for DNS lookup, TCP and TLS setup. Goes through the proxy set
+ * on the manager, so must be called after the proxy is changed. */
+void MainWindow::preconnect()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    // Offer HTTP/2 so the connection can be used by HTTP/2 requests
+    QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+    ssl.setAllowedNextProtocols(QList<QByteArray>()
+                                << QSslConfiguration::ALPNProtocolHTTP2
+                                << QSslConfiguration::NextProtocolHttp1_1);
+    manager.connectToHostEncrypted(EPGUIDES_HOST, 443, ssl);
+#else
+    manager.connectToHostEncrypted(EPGUIDES_HOST);
+#endif
+    log(QString("Connecting to %1").arg(EPGUIDES_HOST));
 }
 
 void MainWindow::on_settingsButton_clicked()
@@ -705,8 +1745,12 @@ void MainWindow::on_settingsButton_clicked()
     ui->checkBox_proxySystem->setChecked(useSystemProxy);
     ui->lineEdit_ProxyAddress->setText( proxyAddress );
     ui->lineEdit_ProxyPort->setText( QString::number(proxyPort) );
+    ui->spinBox_parseThreads->setValue(parseThreads);
+    ui->checkBox_logToFile->setChecked(logToFile);
+    ui->spinBox_epCacheBudget->setValue(epCacheBudgetMB);
 
     ui->stackedWidget->setCurrentWidget(ui->page_settings);
+    updateLogView();
 }
 
 void MainWindow::on_pushButton_OpenSettingsFolder_clicked()
@@ -729,3 +1773,129 @@ void MainWindow::on_button_about_back_clicked()
 {
     ui->stackedWidget->setCurrentWidget(ui->page_settings);
 }
+
+void MainWindow::on_renameButton_clicked()
+{
+    if (!currentSeries) { return; }
+
+    // Index new file names by season and episode number
+    renameNames.clear();
+    foreach (EpisodePtr ep, epList) {
+        if (ep->special) { continue; }
+        QString name = QString("%1 %2 - %3")
+                .arg(ep->series->name).arg(ep->number).arg(ep->name);
+        renameNames.insert(EpisodeRenamer::EpisodeKey(ep->seasonNo, ep->episodeNo),
+                           EpisodeRenamer::safeFileName(name));
+    }
+
+    renameItems.clear();
+    ui->listWidget_rename->clear();
+    ui->label_renameSeries->setText("Rename files of " + currentSeries->name);
+    ui->label_renameStatus->clear();
+    updateRenameGUI();
+
+    ui->stackedWidget->setCurrentWidget(ui->page_rename);
+}
+
+void MainWindow::on_button_rename_back_clicked()
+{
+    ui->stackedWidget->setCurrentWidget(ui->page_main);
+}
+
+void MainWindow::on_pushButton_renameBrowse_clicked()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, "Media directory",
+                                                    ui->lineEdit_renameDir->text());
+    if (!dir.isEmpty()) {
+        ui->lineEdit_renameDir->setText(dir);
+    }
+}
+
+void MainWindow::on_pushButton_renameScan_clicked()
+{
+    QString dir = ui->lineEdit_renameDir->text();
+    if (dir.isEmpty() || !QDir(dir).exists()) {
+        ui->label_renameStatus->setText("Directory does not exist");
+        return;
+    }
+
+    renameItems.clear();
+    ui->listWidget_rename->clear();
+    ui->label_renameStatus->setText("Scanning...");
+
+    // Scan and match in the background
+    QHash<EpisodeRenamer::EpisodeKey, QString> names = renameNames;
+    renameScanWatcher.setFuture(QtConcurrent::run([=]() {
+        return EpisodeRenamer::match(EpisodeRenamer::scan(dir), names);
+    }));
+    updateRenameGUI();
+}
+
+void MainWindow::renameScanFinished()
+{
+    renameItems = renameScanWatcher.result();
+
+    QStringList preview;
+    foreach (RenameItem item, renameItems) {
+        preview.append(QString("%1 -> %2")
+                       .arg(QFileInfo(item.oldPath).fileName())
+                       .arg(QFileInfo(item.newPath).fileName()));
+    }
+    ui->listWidget_rename->addItems(preview);
+
+    ui->label_renameStatus->setText(QString("%1 files to rename").arg(renameItems.count()));
+    updateRenameGUI();
+}
+
+void MainWindow::on_pushButton_renameApply_clicked()
+{
+    if (renameItems.isEmpty()) { return; }
+
+    QList<RenameItem> items = renameItems;
+    QString undoLogFile = getSettingsDir(RENAME_UNDO_FILENAME);
+    renameDoneMsg = QString("Renamed %1 files").arg(items.count());
+    ui->label_renameStatus->setText("Renaming...");
+
+    renameWatcher.setFuture(QtConcurrent::run([=]() {
+        return EpisodeRenamer::rename(items, undoLogFile);
+    }));
+    updateRenameGUI();
+}
+
+void MainWindow::on_pushButton_renameUndo_clicked()
+{
+    QString undoLogFile = getSettingsDir(RENAME_UNDO_FILENAME);
+    renameDoneMsg = "Undid last rename";
+    ui->label_renameStatus->setText("Undoing...");
+
+    renameWatcher.setFuture(QtConcurrent::run([=]() {
+        return EpisodeRenamer::undo(undoLogFile);
+    }));
+    updateRenameGUI();
+}
+
+void MainWindow::renameFinished()
+{
+    QString error = renameWatcher.result();
+    if (error.isEmpty()) {
+        ui->label_renameStatus->setText(renameDoneMsg);
+        log(renameDoneMsg);
+    } else {
+        ui->label_renameStatus->setText(error);
+        log(error, LogError);
+    }
+
+    // File names changed, so the preview is no longer valid
+    renameItems.clear();
+    ui->listWidget_rename->clear();
+    updateRenameGUI();
+}
+
+void MainWindow::updateRenameGUI()
+{
+    bool busy = renameScanWatcher.isRunning() || renameWatcher.isRunning();
+    ui->pushButton_renameScan->setEnabled(!busy);
+    ui->pushButton_renameApply->setEnabled(!busy && !renameItems.isEmpty());
+    ui->pushButton_renameUndo->setEnabled(
+                !busy && QFile::exists(getSettingsDir(RENAME_UNDO_FILENAME)));
+}
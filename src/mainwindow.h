@@ -2,35 +2,77 @@
 #define SERIES_H
 
 
+#include <QCache>
 #include <QClipboard>
 #include <QCoreApplication>
 #include <QDate>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QListWidgetItem>
+#include <QLocalServer>
+#include <QLocalSocket>
 #include <QNetworkAccessManager>
 #include <QNetworkProxy>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QPair>
+#include <QSet>
 #include <QSharedPointer>
+#include <QSslConfiguration>
 #include <QStandardPaths>
 #include <QStringList>
-#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QTreeWidgetItem>
 #include <QUrl>
+#include <QVector>
 #include <QWidget>
 
+#include "episodecachestore.h"
+#include "episodeindex.h"
+#include "episodeparser.h"
+#include "episoderenamer.h"
+#include "logger.h"
+#include "seriessummary.h"
+#include "watchedstore.h"
+
 
 #define SETTINGS_FILENAME "seriesSettings.txt"
 #define SETTINGS_PROXY_ADDRESS "proxyAddress"
 #define SETTINGS_PROXY_PORT "proxyPort"
 #define SETTINGS_PROXY_SYSTEM "proxyUseSystem"
+#define SETTINGS_PARSE_THREADS "parseThreads"
+#define SETTINGS_LOG_TO_FILE "logToFile"
+#define SETTINGS_EPCACHE_BUDGET "epCacheBudgetMB"
+#define SETTINGS_PRECONNECT "preconnect"
 
 #define SERIESLIST_FILENAME "seriesList.txt"
 #define SERIESLIST_FAV_FILENAME "seriesListFavourites.txt"
+#define EPINDEX_FILENAME "episodeIndex.dat"
+#define SUMMARIES_FILENAME "seriesSummaries.dat"
+#define EPCACHES_FILENAME "episodeCaches.dat"
+#define RENAME_UNDO_FILENAME "renameUndo.txt"
+#define WATCHED_FILENAME "watched.dat"
+#define LOG_FILENAME "seriesapp.log"
+
+// Search text prefix to search episode titles instead of series names
+#define SEARCH_EPISODES_PREFIX "ep:"
 
 #define SERIESAPP_VERSION "1.1.3"
 
+// Prefix of the local socket name, used to find a running instance
+#define LOCAL_SERVER_PREFIX "seriesapp-"
+// Time after which a connection to the local server is closed, so that clients
+// that never send a complete command are dropped
+#define LOCAL_CLIENT_TIMEOUT_MS 5000
+
+#define EPGUIDES_HOST "epguides.com"
+#define EPGUIDES_URL "https://" EPGUIDES_HOST
+
 #define DLMODE_NONE "none"
 #define DLMODE_SERIESLIST "seriesList"
 #define DLMODE_EPLIST "epList"
@@ -39,157 +81,60 @@
 #define VIEWMODE_SERIES "series"
 #define VIEWMODE_EPISODES "episodes"
 
+// Maximum total number of episodes of parsed lists kept in memory
+#define EPLIST_CACHE_MAX_EPISODES 20000
+
+// Series with an episode aired this many days ago or less are marked as new
+#define SERIES_NEW_DAYS 7
 
-struct Series
+// Delay after the series list is loaded before episode caches are cleaned up
+#define EPCACHE_CLEANUP_DELAY_MS 5000
+
+
+// Range of series in a QVector, as begin and end iterators
+typedef QPair<QVector<SeriesPtr>::const_iterator,
+              QVector<SeriesPtr>::const_iterator> SeriesRange;
+
+/* Series search, split into the text to search for and the filters */
+struct SeriesQuery
 {
-    Series(QString txt)
-    {
-        rawText = txt;
-        if (!txt.startsWith('"')) {
-            valid = false;
-            return;
-        }
-        valid = true;
-
-        QStringList cols = rawTextToColumns(txt);
-
-        // Series name
-        name = cols.value(0);
-        // Remove quotes
-        name.remove(0, 1);
-        name.remove(name.count()-1, 1);
-
-        name = decodeHtml(name);
-
-        // Series Rage code
-        rageNo = cols.value(2);
-
-        // Series Maze code
-        mazeNo = cols.value(3);
-
-        // Series directory
-        directory = cols.value(1);
-
-        // Series start date
-        date = cols.value(4);
-        // Simplify date to account for double spaces
-        year = date.simplified().split(" ").value(1).toInt();
-    }
-
-    bool valid;
-    QString rawText;
-    QString name;
-    QString rageNo;
-    QString mazeNo;
-    QString directory;
-    QString date;
-    int year;
-
-    static QStringList rawTextToColumns(QString txt)
-    {
-        QStringList cols;
-
-        QString col;
-        bool inQuotes = false;
-        for (int i=0; i < txt.count(); i++) {
-            QChar c = txt.at(i);
-            if (c == '"') {
-                inQuotes = !inQuotes;
-                col += c;
-            } else if (c == ',') {
-                if (inQuotes) {
-                    col += c;
-                } else {
-                    cols.append(col);
-                    col.clear();
-                    inQuotes = false;
-                }
-            } else {
-                col += c;
-            }
-        }
-        cols.append(col);
-
-        return cols;
-    }
-
-    static QString decodeHtml(QString html)
-    {
-        QTextDocument t;
-        t.setHtml(html);
-        return t.toPlainText();
-    }
+    QString text;               // Folded by Series::makeSearchKey()
+    int yearFrom = 0;           // 0 if unbounded
+    int yearTo = 0;             // 0 if unbounded
+    QString status;             // "running", "ended" or empty for any
+
+    bool hasYearRange() const { return (yearFrom > 0) || (yearTo > 0); }
+    bool isEmpty() const { return text.isEmpty() && !hasYearRange() && status.isEmpty(); }
 };
-typedef QSharedPointer<Series> SeriesPtr;
 
-struct Episode
+// Parsed episode list kept in memory, see MainWindow::epListCache
+struct CachedEpList
 {
-    Episode(QString txt, SeriesPtr parentSeries)
-    {
-        rawText = txt;
-        series = parentSeries;
-
-        if (txt.at(0).isDigit() || txt.startsWith("S")) {
-            valid = true;
-        } else {
-            valid = false;
-            return;
-        }
-
-        // Format if maze number was used:
-        // number,season,episode,airdate,title,tvmaze link
-        // 1,1,1,01 Oct 06,"Dexter","https://www.tvmaze.com/episodes/11596/dexter-1x01-dexter"
-
-        // Format if rage number was used:
-        // number,season,episode,production code,airdate,title,special?,tvrage
-        // 1,1,1,"",9/Jun/89,"Pilot",n
-
-        QStringList cols = Series::rawTextToColumns(txt);
-        bool maze = !parentSeries->mazeNo.isEmpty();
-
-        // Episode name
-        name = cols.value( maze ? 4 : 5 );
-        // Remove quotes
-        name.remove(0, 1);
-        name.remove(name.count()-1, 1);
-
-        name = Series::decodeHtml(name);
-
-        // Episode number
-        number = cols.value(2);
-        if (number.length() == 1) { number.prepend("0"); }
-        number.prepend(cols.value(1)); // Season number
-        if (cols.value(0).startsWith("S")) {
-            number.prepend("S");
-        }
-
-        // Episode date
-        QString dateRaw = cols.value(maze ? 3 : 4);
-        dateRaw = dateRaw.simplified(); // Simplify to account for double spaces
-        if (maze) {
-            date = QLocale(QLocale::English, QLocale::UnitedStates).toDate(
-                       dateRaw, "dd MMM yy");
-        } else {
-            date = QLocale(QLocale::English, QLocale::UnitedStates).toDate(
-                       dateRaw, "d/MMM/yy");
-            if (!date.isValid()) {
-                date = QLocale(QLocale::English, QLocale::UnitedStates).toDate(
-                           dateRaw, "dd/MMM/yy");
-            }
-        }
-        if (date.year() < series->year) {
-            date = date.addYears(100);
-        }
-    }
-
-    bool valid;
-    SeriesPtr series;
-    QString rawText;
-    QString name;
-    QString number;
-    QDate date;
+    QList<EpisodePtr> episodes;
+    QDate date;                 // Date the list was downloaded
+};
+
+// Series view state, kept while viewing episodes to restore on back. The
+// series list widget itself is left as it is in the meantime.
+struct SeriesViewState
+{
+    bool valid = false;
+    QString searchText;
+    QString label;
+    int scrollPos = 0;
+    bool favouritesOnTop = false;
+    int favRevision = 0;
+    int watchedRevision = 0;
+    int summaryRevision = 0;
+};
+
+// Timestamps of the stages of a download, in ms since it was started
+struct DownloadTiming
+{
+    QElapsedTimer timer;
+    qint64 encrypted = -1;      // Connection set up and TLS handshake done
+    qint64 firstByte = -1;      // Response headers received
 };
-typedef QSharedPointer<Episode> EpisodePtr;
 
 namespace Ui {
     class MainWindow;
@@ -205,14 +150,31 @@ public:
 
     QNetworkAccessManager manager;  // Object that manages downloads
     QNetworkReply *currentDownload;
+    QHash<QNetworkReply*, DownloadTiming> downloadTimings;
 
     QList<SeriesPtr> seriesList;  // List of all series
     QHash<QString, SeriesPtr> seriesNumberMap;
-    QList<int> seriesListGUI;   // List of all series displayed in GUI,
-                                // containing int referring to index of series in main seriesList
-    QList<SeriesPtr> favList;        // Favourite series list
+    QVector<SeriesPtr> seriesByYear; // seriesList sorted by start year
+    QList<SeriesPtr> seriesListGUI; // Series displayed in GUI, parallel to listWidget rows
+    QList<SeriesPtr> favList;   // Favourite series list, in display order
+    QSet<QString> favIds;       // Ids of favourite series, for fast lookups
+    int favRevision = 0;        // Incremented whenever favourites change
+    bool favouritesOnTop = false; // Series view starts with favList rows
     QList<EpisodePtr> epList;
+    QList< QList<EpisodePtr> > epSeasons; // epList grouped by season, as displayed
+    QCache<QString, CachedEpList> epListCache; // Recently viewed episode lists by series id
+    SeriesViewState seriesViewState;
+    WatchedStore watched;       // Watched episodes of all series
+    int currentAiredOrdinal = 0; // Highest ordinal of aired episodes in epList
     QStringList epLineList;     // Contains episode list lines (raw)
+    EpisodeIndex epIndex;       // Index of episode titles of all cached series
+    bool epIndexLoaded = false;
+    SeriesSummaryStore summaries; // Summaries of the cached episode lists
+    bool summariesLoaded = false;
+    EpisodeCacheStore epCaches; // Size and last use of episode cache files
+    bool epCachesLoaded = false;
+    QFutureWatcher< QHash<QString, EpisodeCacheStore::Entry> > epCacheScanWatcher;
+    int epCacheBudgetMB = 50;   // Disk budget of episode caches, 0 for no limit
     QString dlMode = DLMODE_NONE; // Mode of current download
     QString viewMode = VIEWMODE_NONE; // What the list is currently viewing; one of: series, episodes
     SeriesPtr currentSeries;      // Current series being viewed
@@ -221,7 +183,6 @@ public:
     QFileInfo epListFileInfo;   // Info of the cached episodes file
 
     int currentListAge;         // Age of cache file of currently displayed list, in days
-    int currentEpIsFavourite;   // Indicates whether the current episode is in the favourite list or not
 
     int calculateDaysOld(QFileInfo fileInfo);
     void addDaysOldString(QString &str, int days);
@@ -229,33 +190,92 @@ public:
     bool useSystemProxy = true;
     QString proxyAddress;
     int proxyPort = 0;
+    bool usePreconnect = true;  // Only set in the settings file, e.g. by the benchmark
     void setProxy();
-
-    void log(QString msg);
+    void preconnect();
+
+    // Batch renaming of media files to episode names
+    QHash<EpisodeRenamer::EpisodeKey, QString> renameNames;
+    QList<RenameItem> renameItems;
+    QFutureWatcher< QList<RenameItem> > renameScanWatcher;
+    QFutureWatcher<QString> renameWatcher;
+    QString renameDoneMsg;
+    void updateRenameGUI();
+
+    int parseThreads = 0;       // Threads used to parse the series list, 0 for automatic
+    QThreadPool parsePool;
+
+    // Log messages are kept by the logger and only shown when the settings
+    // page, where the log is, is opened
+    Logger logger;
+    bool logToFile = false;
+    QTimer logViewTimer;
+    void log(QString msg, LogLevel level = LogInfo);
+    void updateLogView();
+    void logInvalidLines(const EpisodeListParser &parser, SeriesPtr s);
+
+    QLocalServer localServer;   // Serves other instances and local tools
+    bool otherInstanceRunning = false; // Another instance owns the local server
+    bool startLocalServer();
+    static QString localServerName();
+    static bool sendToRunningInstance(QString command, QString *reply = 0);
+    QString handleLocalCommand(QString command);
+    void searchFor(QString query);
 
     QString getSettingsDir(QString addfile = "");
     QString getSeriesCacheFilename(SeriesPtr s);
     void doDownload(const QUrl &url);
+    void logDownloadTiming(QNetworkReply *reply);
 
     void loadEpList(int index);
     void loadEpList(SeriesPtr s, bool redownload = false);
-    void addLineToSeriesList(QString line);
+    void parseSeriesList(const QByteArray &data);
+    void addToSeriesList(SeriesPtr s);
+    SeriesQuery parseSeriesQuery(QString searchText);
+    bool matchesQuery(const SeriesPtr &s, const SeriesQuery &query);
+    SeriesRange seriesInYearRange(int from, int to);
     void saveSeriesFile();
     bool loadSeriesListFile();
     int strToMonth(QString month);
-    void addFavListToGUI();
+    void showSeriesRows(const QList<SeriesPtr> &rows, const QStringList &texts);
+    void colourSeriesRow(int row);
+    void toggleFavouriteRows(SeriesPtr s);
+    void saveSeriesViewState();
+    void restoreSeriesView();
+    bool isFavourite(SeriesPtr s);
+    void addFavourite(SeriesPtr s);
+    void removeFavourite(SeriesPtr s);
+    void resolveFavourites();
+    SeriesPtr selectedSeries();
     bool loadFavListFile();
     void saveFavFile();
     bool loadSettingsFile();
     void saveSettingsFile();
     void clearEpisodeLists();
     bool loadEpListFile(SeriesPtr s);
-    void addLineToEpisodeList(QString line);
+    void addLineToEpisodeList(EpisodeListParser &parser, QString line);
+    void addEpListToGUI();
+    QTreeWidgetItem* createEpisodeItem(EpisodePtr ep);
+    EpisodePtr episodeFromItem(QTreeWidgetItem* item);
+    bool loadEpListFromMemory(SeriesPtr s);
+    void cacheEpList(SeriesPtr s, QDate date);
     void saveEpCacheFile();
+    void buildCacheIndexes();
+    static SeriesSummary summariseEpisodes(const QList<EpisodePtr> &episodes,
+                                           QDate cacheDate);
+    QString seriesRowText(SeriesPtr s);
+    QString favouriteRowText(SeriesPtr s);
+    void cleanUpEpisodeCaches();
+    void evictEpisodeCaches();
+    void updateEpisodeIndex();
+    void searchEpisodes(QString query, QList<SeriesPtr> &rows, QStringList &texts);
     void updateGUI();
     void toggleStarButton(int bright);
 
 private:
+    // Drives searches and episode lists through the GUI, see bench/benchmark
+    friend class Benchmark;
+
     Ui::MainWindow *ui;
 
     const QColor favBgColor {200, 200, 20};
@@ -283,6 +303,22 @@ private slots:
     void on_pushButton_About_clicked();
     void on_button_settings_back_clicked();
     void on_button_about_back_clicked();
+    void on_renameButton_clicked();
+    void on_button_rename_back_clicked();
+    void on_pushButton_renameBrowse_clicked();
+    void on_pushButton_renameScan_clicked();
+    void on_pushButton_renameApply_clicked();
+    void on_pushButton_renameUndo_clicked();
+    void on_spinBox_yearFrom_editingFinished();
+    void on_spinBox_yearTo_editingFinished();
+    void on_comboBox_status_activated(int index);
+    void localConnection();
+    void episodeItemChanged(QTreeWidgetItem* item, int column);
+    void episodeSeasonExpanded(QTreeWidgetItem* item);
+    void on_treeWidget_episodes_itemDoubleClicked(QTreeWidgetItem* item, int column);
+    void renameScanFinished();
+    void epCacheScanFinished();
+    void renameFinished();
 };
 
 #endif // SERIES_H
@@ -0,0 +1,30 @@
+# Sources of the application apart from main.cpp, shared with the benchmark in
+# bench/benchmark
+
+INCLUDEPATH += $$PWD
+
+HEADERS  += \
+    $$PWD/episodecachestore.h \
+    $$PWD/episodeindex.h \
+    $$PWD/episodeparser.h \
+    $$PWD/episoderenamer.h \
+    $$PWD/filestore.h \
+    $$PWD/logger.h \
+    $$PWD/mainwindow.h \
+    $$PWD/seriessummary.h \
+    $$PWD/watchedstore.h
+
+SOURCES += \
+    $$PWD/episodecachestore.cpp \
+    $$PWD/episodeindex.cpp \
+    $$PWD/episoderenamer.cpp \
+    $$PWD/filestore.cpp \
+    $$PWD/logger.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/seriessummary.cpp \
+    $$PWD/watchedstore.cpp
+
+FORMS    += \
+    $$PWD/mainwindow.ui
+
+RESOURCES += $$PWD/../res/icons.qrc
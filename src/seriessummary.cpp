@@ -0,0 +1,65 @@
+#include "seriessummary.h"
+
+#define SERIESSUMMARY_MAGIC 0x53455353 // "SESS"
+#define SERIESSUMMARY_VERSION 1
+
+SeriesSummaryStore::SeriesSummaryStore() :
+    FileStore(SERIESSUMMARY_MAGIC, SERIESSUMMARY_VERSION)
+{
+}
+
+SeriesSummaryStore::~SeriesSummaryStore()
+{
+    saveIfChanged();
+}
+
+bool SeriesSummaryStore::contains(QString seriesId) const
+{
+    return summaries.contains(seriesId);
+}
+
+SeriesSummary SeriesSummaryStore::value(QString seriesId) const
+{
+    return summaries.value(seriesId);
+}
+
+void SeriesSummaryStore::set(QString seriesId, const SeriesSummary &summary)
+{
+    summaries.insert(seriesId, summary);
+    changed();
+}
+
+void SeriesSummaryStore::remove(QString seriesId)
+{
+    if (summaries.remove(seriesId)) {
+        changed();
+    }
+}
+
+void SeriesSummaryStore::clear()
+{
+    summaries.clear();
+}
+
+void SeriesSummaryStore::read(QDataStream &in)
+{
+    // Id length, episode count and three dates
+    readItems(in, 4 + 4 + 3 * 8, [&]() {
+        QString id;
+        SeriesSummary s;
+        qint32 episodeCount = 0;
+        in >> id >> episodeCount >> s.lastAired >> s.nextAiring >> s.cacheDate;
+        s.episodeCount = episodeCount;
+        summaries.insert(id, s);
+    });
+}
+
+void SeriesSummaryStore::write(QDataStream &out) const
+{
+    out << qint32(summaries.count());
+    QHash<QString, SeriesSummary>::const_iterator it;
+    for (it = summaries.constBegin(); it != summaries.constEnd(); ++it) {
+        out << it.key() << qint32(it->episodeCount)
+            << it->lastAired << it->nextAiring << it->cacheDate;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SERIESSUMMARY_H
+#define SERIESSUMMARY_H
+
+
+#include <QDate>
+#include <QHash>
+#include <QString>
+
+#include "filestore.h"
+
+
+struct SeriesSummary
+{
+    int episodeCount = 0;
+    QDate lastAired;    // Latest episode aired when the list was cached
+    QDate nextAiring;   // First episode after the list was cached, if known
+    QDate cacheDate;    // When the episode list was downloaded
+};
+
+/* Keeps a summary of the cached episode list of each series, so that the
+ * series list can show when shows have new or upcoming episodes without
+ * reading the episode cache files. Summaries are updated whenever an episode
+ * list is saved to cache. */
+class SeriesSummaryStore : public FileStore
+{
+public:
+    SeriesSummaryStore();
+    ~SeriesSummaryStore();
+
+    bool contains(QString seriesId) const;
+    SeriesSummary value(QString seriesId) const;
+    void set(QString seriesId, const SeriesSummary &summary);
+    void remove(QString seriesId);
+
+protected:
+    void clear() override;
+    void read(QDataStream &in) override;
+    void write(QDataStream &out) const override;
+
+private:
+    QHash<QString, SeriesSummary> summaries;
+};
+
+
+#endif // SERIESSUMMARY_H
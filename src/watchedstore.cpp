@@ -0,0 +1,141 @@
+#include "watchedstore.h"
+
+#define WATCHEDSTORE_MAGIC 0x53455757 // "SEWW"
+#define WATCHEDSTORE_VERSION 1
+
+WatchedStore::WatchedStore() :
+    FileStore(WATCHEDSTORE_MAGIC, WATCHEDSTORE_VERSION)
+{
+}
+
+WatchedStore::~WatchedStore()
+{
+    saveIfChanged();
+}
+
+bool WatchedStore::isWatched(QString seriesId, int ordinal) const
+{
+    if (ordinal <= 0) { return false; }
+    QHash<QString, SeriesBits>::const_iterator it = series.constFind(seriesId);
+    if (it == series.constEnd()) { return false; }
+
+    int word = (ordinal - 1) / 64;
+    if (word >= it->bits.count()) { return false; }
+    return (it->bits.at(word) >> ((ordinal - 1) % 64)) & 1;
+}
+
+void WatchedStore::setWatched(QString seriesId, int ordinal, bool watched)
+{
+    if (ordinal <= 0) { return; }
+    if (isWatched(seriesId, ordinal) == watched) { return; }
+
+    SeriesBits &s = series[seriesId];
+    int word = (ordinal - 1) / 64;
+    if (word >= s.bits.count()) {
+        s.bits.resize(word + 1);
+    }
+    quint64 mask = quint64(1) << ((ordinal - 1) % 64);
+    if (watched) {
+        s.bits[word] |= mask;
+    } else {
+        s.bits[word] &= ~mask;
+    }
+    changed();
+}
+
+/* Sets the highest ordinal of the series' episodes that have aired. Called
+ * whenever its episode list is loaded. */
+void WatchedStore::setAired(QString seriesId, int aired)
+{
+    QHash<QString, SeriesBits>::iterator it = series.find(seriesId);
+    if (it == series.end()) {
+        // Nothing watched yet; only keep track of series with watched episodes
+        return;
+    }
+    if (it->aired != aired) {
+        it->aired = aired;
+        changed();
+    }
+}
+
+/* Returns the number of aired episodes not watched yet, or -1 if no episodes of
+ * the series are being tracked. */
+int WatchedStore::unwatchedCount(QString seriesId) const
+{
+    QHash<QString, SeriesBits>::const_iterator it = series.constFind(seriesId);
+    if (it == series.constEnd()) { return -1; }
+    return qMax(0, it->aired - watchedAired(*it));
+}
+
+/* Returns the number of watched episodes that have aired. Episodes can be
+ * ticked before they air, which must not lower the unwatched count. */
+int WatchedStore::watchedAired(const SeriesBits &s)
+{
+    int count = 0;
+    for (int word=0; (word * 64 < s.aired) && (word < s.bits.count()); word++) {
+        quint64 bits = s.bits.at(word);
+        int left = s.aired - word * 64;
+        if (left < 64) {
+            bits &= (quint64(1) << left) - 1;
+        }
+        // Count set bits
+        for (; bits; bits &= bits - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Returns the ordinal of the first aired episode not watched yet, or 0 if
+ * there is none. */
+int WatchedStore::nextUnwatched(QString seriesId) const
+{
+    QHash<QString, SeriesBits>::const_iterator it = series.constFind(seriesId);
+    if (it == series.constEnd()) { return 0; }
+
+    for (int word=0; word * 64 < it->aired; word++) {
+        quint64 bits = (word < it->bits.count()) ? it->bits.at(word) : 0;
+        if (bits == ~quint64(0)) { continue; }
+        int bit = 0;
+        while ((bits >> bit) & 1) { bit++; }
+        int ordinal = word * 64 + bit + 1;
+        return (ordinal <= it->aired) ? ordinal : 0;
+    }
+    return 0;
+}
+
+void WatchedStore::clear()
+{
+    series.clear();
+}
+
+void WatchedStore::read(QDataStream &in)
+{
+    // Id length, aired count and word count
+    readItems(in, 4 + 4 + 4, [&]() {
+        QString id;
+        SeriesBits s;
+        qint32 aired = 0;
+        in >> id >> aired;
+        s.aired = aired;
+
+        // Words are read one by one, as streaming the vector would reserve
+        // room for the count read from the file before reading any of them
+        int words = readCount(in, 8);
+        for (int i=0; (i < words) && (in.status() == QDataStream::Ok); i++) {
+            quint64 bits = 0;
+            in >> bits;
+            s.bits.append(bits);
+        }
+        series.insert(id, s);
+    });
+}
+
+void WatchedStore::write(QDataStream &out) const
+{
+    out << qint32(series.count());
+    QHash<QString, SeriesBits>::const_iterator it;
+    for (it = series.constBegin(); it != series.constEnd(); ++it) {
+        out << it.key() << qint32(it->aired) << it->bits;
+    }
+}
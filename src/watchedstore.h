@@ -0,0 +1,45 @@
+#ifndef WATCHEDSTORE_H
+#define WATCHEDSTORE_H
+
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "filestore.h"
+
+
+/* Keeps track of watched episodes. Per series, a bitset has bit n-1 set if
+ * the episode with ordinal n (its overall number in the episode list) was
+ * watched. Together with the number of aired episodes, this answers the
+ * unwatched count and next unwatched episode without the episode list. */
+class WatchedStore : public FileStore
+{
+public:
+    WatchedStore();
+    ~WatchedStore();
+
+    bool isWatched(QString seriesId, int ordinal) const;
+    void setWatched(QString seriesId, int ordinal, bool watched);
+    void setAired(QString seriesId, int aired);
+    int unwatchedCount(QString seriesId) const;
+    int nextUnwatched(QString seriesId) const;
+
+protected:
+    void clear() override;
+    void read(QDataStream &in) override;
+    void write(QDataStream &out) const override;
+
+private:
+    struct SeriesBits
+    {
+        QVector<quint64> bits;
+        int aired = 0;      // Highest ordinal aired when last updated
+    };
+    QHash<QString, SeriesBits> series;
+
+    static int watchedAired(const SeriesBits &s);
+};
+
+
+#endif // WATCHEDSTORE_H